@@ -0,0 +1,16 @@
+// Compiles third_party/cactus_kev into namespace cactus_kev; see baselines.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+namespace cactus_kev {
+
+#include "third_party/cactus_kev/poker.cc"
+
+// poker.cc declares these for shuffle_deck without defining them.
+void srand48() {}
+double drand48() { return ::drand48(); }
+
+}  // namespace cactus_kev
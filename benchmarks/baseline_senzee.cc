@@ -0,0 +1,12 @@
+// Compiles third_party/senzee into namespace senzee; see baselines.h.
+
+#include <stdio.h>
+
+#include <string>
+
+namespace senzee {
+
+#include "third_party/senzee/mtrand.cc"
+#include "third_party/senzee/poker.cc"
+
+}  // namespace senzee
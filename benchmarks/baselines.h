@@ -0,0 +1,24 @@
+#pragma once
+
+// The vendored evaluators the tables are compared against.
+//
+// Both define the same global symbols (init_deck, eval_5hand, ...), so each is
+// compiled into a namespace of its own by baseline_cactus_kev.cc and
+// baseline_senzee.cc. Cards are in their native encoding: the values filled
+// into a deck by init_deck, where deck[13 * suit + rank] is the card.
+
+namespace cactus_kev {
+void init_deck(int* deck);
+// Binary search over the unique5 table.
+short eval_5hand(int* hand);
+// Best of the 21 five-card subsets, each through eval_5hand.
+short eval_7hand(int* hand);
+}  // namespace cactus_kev
+
+namespace senzee {
+void init_deck(int* deck);
+// Perfect hash instead of the binary search.
+int eval_5hand_fast(int c1, int c2, int c3, int c4, int c5);
+// Best of the 21 five-card subsets, each through eval_5hand_fast.
+short eval_7hand(int* hand);
+}  // namespace senzee
@@ -1,36 +1,58 @@
 #include <algorithm>
 #include <array>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
 #include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
-#include <random>
+
+#include <unistd.h>
 
 #define ANKERL_NANOBENCH_IMPLEMENT
 #include "third_party/nanobench/nanobench.h"
+#include "benchmarks/baselines.h"
+#include "compact_hand_eval.h"
+#include "instrumentation.h"
+#include "numa_hand_eval.h"
+#include "omaha_hand_eval.h"
 #include "poker_hand_eval.h"
+#include "suit_canonical_hand_eval.h"
+#include "unified_hand_eval.h"
+
+using ankerl::nanobench::Bench;
+using ankerl::nanobench::doNotOptimizeAway;
 
 template <size_t HandSize>
 using HandType = std::array<uint32_t, HandSize>;
-using DeckType = std::array<uint32_t, 52>;
 
+// Number of pre-generated hands per stream. A power of two, for eval_chain.
+constexpr size_t kNumHands = 1 << 16;
+
+// Deals `count` hands of distinct cards, the same ones for a given seed.
+//
+// Hands are generated before timing starts, so that no benchmark pays for a
+// random number generator on its critical path.
 template <size_t HandSize>
-HandType<HandSize> random_hand() {
-  static DeckType deck = []() {
-    DeckType d;
-    for (size_t i = 0; i < 52; i++) { d[i] = i; }
-    return d;
-  }();
-  static std::mt19937 g(42);
-  static size_t deal_index = 52;
-  if (deal_index + HandSize >= 52) {
-    std::shuffle(std::begin(deck), std::end(deck), g);
-    deal_index = 0;
-  }
+std::vector<HandType<HandSize>> deal_hands(size_t count, uint32_t seed = 42) {
+  std::array<uint32_t, 52> deck;
+  std::iota(deck.begin(), deck.end(), 0);
+  std::mt19937 g(seed);
 
-  HandType<HandSize> hand;
-  std::copy_n(std::next(std::begin(deck), deal_index), HandSize, std::begin(hand));
-  deal_index += HandSize;
-  return hand;
+  std::vector<HandType<HandSize>> hands(count);
+  for (auto& hand : hands) {
+    // Partial Fisher-Yates shuffle of the first HandSize cards.
+    for (size_t i = 0; i < HandSize; i++) {
+      std::swap(deck[i], deck[i + g() % (52 - i)]);
+    }
+    std::copy_n(deck.begin(), HandSize, hand.begin());
+  }
+  return hands;
 }
 
 uint64_t choose(uint64_t n, uint64_t k) {
@@ -47,93 +69,855 @@ uint64_t choose(uint64_t n, uint64_t k) {
     return result;
 }
 
+// Evaluates every hand once, each at an index that depends on the previous
+// score. Every table walk waits for the one before it, so this measures the
+// latency of one evaluation. hands.size() must be a power of two.
+template <typename Phe, typename Hands>
+uint32_t eval_chain(const Phe& phe, const Hands& hands) {
+  const size_t mask = hands.size() - 1;
+  size_t index = 0;
+  uint32_t score = 0;
+  for (size_t i = 0; i < hands.size(); i++) {
+    index = (index + 1 + (score & 1)) & mask;
+    score = phe.eval(hands[index]);
+  }
+  return score;
+}
+
+// Evaluates every hand in order. The walks are independent, so the CPU
+// overlaps their loads; this measures the throughput of one core.
+template <typename Phe, typename Hands>
+uint32_t eval_stream(const Phe& phe, const Hands& hands) {
+  uint32_t sum = 0;
+  for (const auto& hand : hands) {
+    sum += phe.eval(hand);
+  }
+  return sum;
+}
+
+// Layouts of the plain table format, in the order they are benchmarked.
+// aligned, page and hugepage have padded rows; see RowPlacement.
+const std::vector<const char*> kFlatLayouts = {"bfs", "dfs", "veb", "pgo", "aligned", "page", "hugepage"};
+
+std::string table_path(const std::string& layout, size_t hand_size, const char* extension = ".phe") {
+  return "tables/" + layout + std::to_string(hand_size) + extension;
+}
+
+// Returns whether `path` exists, and notes the skipped benchmark otherwise.
+bool have_table(const std::string& path) {
+  if (std::ifstream(path).good()) {
+    return true;
+  }
+  std::cerr << "  (skipping " << path << ": not found)\n";
+  return false;
+}
+
+// Calls fn(layout, phe) with an evaluator of every table of HandSize cards on
+// disk, in a fixed order.
+template <size_t HandSize, typename Fn>
+void for_each_layout(Fn fn) {
+  for (const char* layout : kFlatLayouts) {
+    if (have_table(table_path(layout, HandSize))) {
+      PokerHandEval<HandSize> phe(table_path(layout, HandSize));
+      fn(std::string(layout), phe);
+    }
+  }
+  if (have_table(table_path("canon", HandSize))) {
+    SuitCanonicalPokerHandEval<HandSize> phe(table_path("canon", HandSize));
+    fn(std::string("canon"), phe);
+  }
+  if (have_table(table_path("bfs", HandSize, ".phe16"))) {
+    CompactPokerHandEval<HandSize> phe(table_path("bfs", HandSize, ".phe16"));
+    fn(std::string("compact"), phe);
+  }
+  if (HandSize >= 5 && HandSize <= 7 && have_table("tables/unified7.phe")) {
+    // One table serves every hand size.
+    UnifiedPokerHandEval<5, 7> phe("tables/unified7.phe");
+    fn(std::string("unified"), phe);
+  }
+}
+
+// 1, 2, 4, ... threads, up to and including max_threads.
+std::vector<size_t> thread_counts(size_t max_threads) {
+  std::vector<size_t> counts;
+  for (size_t n = 1; n < max_threads; n *= 2) {
+    counts.push_back(n);
+  }
+  counts.push_back(std::max<size_t>(max_threads, 1));
+  return counts;
+}
 
+std::string threads_label(size_t num_threads) {
+  return std::to_string(num_threads) + (num_threads == 1 ? " thread" : " threads");
+}
+
+//////////////////////////////
+// Machine-readable results //
+//////////////////////////////
+
+std::string json_string(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+std::string csv_string(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    out += c;
+    if (c == '"') {
+      out += '"';
+    }
+  }
+  return out + "\"";
+}
+
+// Describes the host, so that results from several machines can be told
+// apart.
+struct MachineInfo {
+  std::string host;
+  std::string cpu;
+  size_t hardware_threads;
+  std::string simd;
+  std::string compiler;
+  std::string date;
+
+  static MachineInfo detect() {
+    MachineInfo info;
+
+    char host[256] = {};
+    gethostname(host, sizeof(host) - 1);
+    info.host = host;
+
+    info.cpu = "unknown";
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (std::string line; std::getline(cpuinfo, line);) {
+      if (line.rfind("model name", 0) == 0 && line.find(':') != std::string::npos) {
+        info.cpu = line.substr(line.find(':') + 2);
+        break;
+      }
+    }
+
+    info.hardware_threads = std::thread::hardware_concurrency();
+    switch (detect_simd_isa()) {
+      case SimdIsa::kScalar: info.simd = "scalar"; break;
+      case SimdIsa::kAvx2: info.simd = "avx2"; break;
+      case SimdIsa::kAvx512: info.simd = "avx512"; break;
+    }
+    info.compiler = __VERSION__;
+
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    info.date = date;
+    return info;
+  }
+};
+
+// Collects the results of every suite that ran, for --json and --csv.
+//
+// Each nanobench run is one result. Suites are told apart by the bench title
+// and layouts by the first word of the result name, e.g. "bfs chain".
+class Report {
+ public:
+  Report(MachineInfo machine, size_t max_threads) : machine_(std::move(machine)), max_threads_(max_threads) {}
+
+  // Upper bound of the thread-scaling suites.
+  size_t max_threads() const { return max_threads_; }
+
+  // Records every result of a finished suite.
+  void add(const Bench& bench) {
+    std::ostringstream json;
+    ankerl::nanobench::render(ankerl::nanobench::templates::json(), bench, json);
+    json_suites_.push_back(json.str());
+
+    using Measure = ankerl::nanobench::Result::Measure;
+    for (const auto& result : bench.results()) {
+      const auto& config = result.config();
+      // Medians are per iteration; report them per unit (hand, board, ...).
+      auto per_unit = [&](Measure m) -> std::string {
+        if (!result.has(m)) {
+          return "";
+        }
+        std::ostringstream value;
+        value << result.median(m) / config.mBatch;
+        return value.str();
+      };
+      std::ostringstream row;
+      row << csv_string(machine_.host) << ',' << csv_string(machine_.cpu) << ','
+          << csv_string(config.mBenchmarkTitle) << ',' << csv_string(config.mBenchmarkName) << ','
+          << csv_string(config.mUnit) << ',' << static_cast<uint64_t>(config.mBatch) << ','
+          << result.median(Measure::elapsed) / config.mBatch * 1e9 << ','
+          << result.medianAbsolutePercentError(Measure::elapsed) * 100 << ','
+          << per_unit(Measure::cpucycles) << ',' << per_unit(Measure::instructions) << ','
+          << per_unit(Measure::branchinstructions) << ',' << per_unit(Measure::branchmisses);
+      csv_rows_.push_back(row.str());
+    }
+  }
+
+  // Writes the machine description and the full nanobench results of every
+  // suite, measurements included.
+  void write_json(const std::string& path) const {
+    std::ofstream out(path);
+    out << "{\n"
+        << "  \"machine\": {\n"
+        << "    \"host\": " << json_string(machine_.host) << ",\n"
+        << "    \"cpu\": " << json_string(machine_.cpu) << ",\n"
+        << "    \"hardware_threads\": " << machine_.hardware_threads << ",\n"
+        << "    \"simd\": " << json_string(machine_.simd) << ",\n"
+        << "    \"compiler\": " << json_string(machine_.compiler) << ",\n"
+        << "    \"date\": " << json_string(machine_.date) << "\n"
+        << "  },\n"
+        << "  \"suites\": [\n";
+    for (size_t i = 0; i < json_suites_.size(); i++) {
+      out << json_suites_[i] << (i + 1 < json_suites_.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    if (!out) {
+      throw std::runtime_error("write " + path + " failed");
+    }
+  }
+
+  // Writes one row per result, with medians per unit.
+  void write_csv(const std::string& path) const {
+    std::ofstream out(path);
+    out << "host,cpu,suite,name,unit,batch,ns_per_unit,err_pct,cycles_per_unit,instructions_per_unit,"
+           "branches_per_unit,branch_misses_per_unit\n";
+    for (const auto& row : csv_rows_) {
+      out << row << '\n';
+    }
+    if (!out) {
+      throw std::runtime_error("write " + path + " failed");
+    }
+  }
+
+ private:
+  MachineInfo machine_;
+  size_t max_threads_;
+  std::vector<std::string> json_suites_;
+  std::vector<std::string> csv_rows_;
+};
+
+////////////
+// Suites //
+////////////
+
+// Latency (dependent chain) and single-core throughput (independent stream)
+// of every layout.
+template <size_t HandSize>
+void bench_latency(Report* report) {
+  std::cout << "\n\nBenchmarking " << HandSize << "-card hand evaluation latency and throughput...\n";
+
+  const auto hands = deal_hands<HandSize>(kNumHands);
+
+  Bench b;
+  b
+      .title("latency" + std::to_string(HandSize))
+      .unit("hand")
+      .warmup(10)
+      .batch(kNumHands)
+      .minEpochIterations(20)
+      .performanceCounters(true);
+
+  for_each_layout<HandSize>([&](const std::string& layout, const auto& phe) {
+    b.run(layout + " chain", [&]() { doNotOptimizeAway(eval_chain(phe, hands)); });
+    b.run(layout + " stream", [&]() { doNotOptimizeAway(eval_stream(phe, hands)); });
+  });
+  report->add(b);
+}
+
+// Latency of the row placements: packed 52-slot rows (bfs) against rows
+// padded to whole cache lines (aligned), and against parents and children
+// clustered into 4 KiB (page) and 2 MiB (hugepage) pages, each with the
+// table on 4 KiB pages and on transparent huge pages. Random hands reach rows
+// all over a 7-card table, so on 4 KiB pages most walks miss the TLB.
+template <size_t HandSize>
+void bench_placement(Report* report) {
+  std::cout << "\n\nBenchmarking " << HandSize << "-card row placements...\n";
+
+  const auto hands = deal_hands<HandSize>(kNumHands);
+
+  Bench b;
+  b
+      .title("placement" + std::to_string(HandSize))
+      .unit("hand")
+      .warmup(10)
+      .batch(kNumHands)
+      .minEpochIterations(20)
+      .performanceCounters(true);
+
+  for (const char* layout : {"bfs", "aligned", "page", "hugepage"}) {
+    if (!have_table(table_path(layout, HandSize))) {
+      continue;
+    }
+    for (bool huge_pages : {false, true}) {
+      PheLoadOptions options;
+      options.populate = true;
+      if (huge_pages) {
+        options.huge_pages = PheLoadOptions::HugePages::kTransparent;
+      }
+      PokerHandEval<HandSize> phe(table_path(layout, HandSize), options);
+      std::string name = std::string(layout) + (huge_pages ? " thp" : " 4k");
+      b.run(name + " chain", [&]() { doNotOptimizeAway(eval_chain(phe, hands)); });
+      b.run(name + " stream", [&]() { doNotOptimizeAway(eval_stream(phe, hands)); });
+    }
+  }
+  report->add(b);
+}
+
+// Cost of CountingInstrumentation over the plain walk.
 template <size_t HandSize>
-void bench_latency() {
-  std::cout << "\n\nBenchmarking " << HandSize << "-card hand evaluation latency...\n";
+void bench_instrumentation(Report* report) {
+  std::cout << "\n\nBenchmarking " << HandSize << "-card instrumented evaluation...\n";
+
+  if (!have_table(table_path("bfs", HandSize))) {
+    return;
+  }
+
+  const auto hands = deal_hands<HandSize>(kNumHands);
 
-  ankerl::nanobench::Bench b;
+  Bench b;
   b
+      .title("instrumentation" + std::to_string(HandSize))
       .unit("hand")
-      .warmup(10000)
+      .warmup(10)
       .relative(true)
-      .performanceCounters(true)
-      .minEpochIterations(10000000);
+      .batch(kNumHands)
+      .minEpochIterations(20)
+      .performanceCounters(true);
+
+  PokerHandEval<HandSize> phe(table_path("bfs", HandSize));
+  b.run("bfs chain", [&]() { doNotOptimizeAway(eval_chain(phe, hands)); });
+  b.run("bfs stream", [&]() { doNotOptimizeAway(eval_stream(phe, hands)); });
+
+  PokerHandEval<HandSize, CountingInstrumentation> counted(table_path("bfs", HandSize));
+  b.run("bfs chain, counting", [&]() { doNotOptimizeAway(eval_chain(counted, hands)); });
+  b.run("bfs stream, counting", [&]() { doNotOptimizeAway(eval_stream(counted, hands)); });
+  report->add(b);
+}
+
+// Adapts a vendored evaluator, which takes its cards as a mutable int array,
+// to the eval(hand) interface of the tables.
+template <size_t HandSize, typename Fn>
+struct Baseline {
+  Fn fn;
+
+  uint32_t eval(std::array<int, HandSize> hand) const { return fn(hand.data()); }
+};
 
-  b.run("control", [&]() {
-    ankerl::nanobench::doNotOptimizeAway(random_hand<HandSize>());
+template <size_t HandSize, typename Fn>
+Baseline<HandSize, Fn> make_baseline(Fn fn) {
+  return {fn};
+}
+
+// Converts hands to the native cards of a vendored evaluator, given the deck
+// filled in by its init_deck.
+template <size_t HandSize>
+std::vector<std::array<int, HandSize>> to_native(const std::vector<HandType<HandSize>>& hands,
+                                                 const std::array<int, 52>& deck) {
+  std::vector<std::array<int, HandSize>> native(hands.size());
+  for (size_t i = 0; i < hands.size(); i++) {
+    for (size_t c = 0; c < HandSize; c++) {
+      // Card 4 * rank + suit is deck[13 * suit + rank].
+      native[i][c] = deck[13 * (hands[i][c] % 4) + hands[i][c] / 4];
+    }
+  }
+  return native;
+}
+
+// Head-to-head against the evaluators the tables were bootstrapped from.
+template <size_t HandSize>
+void bench_baseline(Report* report) {
+  static_assert(HandSize == 5 || HandSize == 7, "The baselines evaluate 5 or 7 cards.");
+  std::cout << "\n\nBenchmarking " << HandSize << "-card hand evaluation against the vendored evaluators...\n";
+
+  if (!have_table(table_path("bfs", HandSize))) {
+    return;
+  }
+
+  const auto hands = deal_hands<HandSize>(kNumHands);
+
+  std::array<int, 52> cactus_kev_deck;
+  cactus_kev::init_deck(cactus_kev_deck.data());
+  const auto cactus_kev_hands = to_native(hands, cactus_kev_deck);
+  std::array<int, 52> senzee_deck;
+  senzee::init_deck(senzee_deck.data());
+  const auto senzee_hands = to_native(hands, senzee_deck);
+
+  auto cactus_kev_phe = make_baseline<HandSize>([](int* hand) -> uint32_t {
+    return HandSize == 5 ? cactus_kev::eval_5hand(hand) : cactus_kev::eval_7hand(hand);
+  });
+  auto senzee_phe = make_baseline<HandSize>([](int* hand) -> uint32_t {
+    return HandSize == 5 ? senzee::eval_5hand_fast(hand[0], hand[1], hand[2], hand[3], hand[4])
+                         : senzee::eval_7hand(hand);
   });
+  PokerHandEval<HandSize> phe(table_path("bfs", HandSize));
 
-  {
-    PokerHandEval<HandSize> phe("tables/bfs" + std::to_string(HandSize) + ".phe");
-    b.run("bfs", [&]() {
-      ankerl::nanobench::doNotOptimizeAway(phe.eval(random_hand<HandSize>()));
+  // The comparison is only meaningful if all three agree.
+  for (size_t i = 0; i < 1000; i++) {
+    uint32_t expected = phe.eval(hands[i]);
+    if (cactus_kev_phe.eval(cactus_kev_hands[i]) != expected || senzee_phe.eval(senzee_hands[i]) != expected) {
+      std::cerr << "  warning: the vendored evaluators disagree with bfs" << HandSize << ".phe\n";
+      break;
+    }
+  }
+
+  Bench b;
+  b
+      .title("baseline" + std::to_string(HandSize))
+      .unit("hand")
+      .warmup(1)
+      .relative(true)
+      .batch(kNumHands)
+      .performanceCounters(true);
+
+  b.run("cactus_kev stream", [&]() { doNotOptimizeAway(eval_stream(cactus_kev_phe, cactus_kev_hands)); });
+  b.run("cactus_kev chain", [&]() { doNotOptimizeAway(eval_chain(cactus_kev_phe, cactus_kev_hands)); });
+  b.run("senzee stream", [&]() { doNotOptimizeAway(eval_stream(senzee_phe, senzee_hands)); });
+  b.run("senzee chain", [&]() { doNotOptimizeAway(eval_chain(senzee_phe, senzee_hands)); });
+  b.run("bfs stream", [&]() { doNotOptimizeAway(eval_stream(phe, hands)); });
+  b.run("bfs chain", [&]() { doNotOptimizeAway(eval_chain(phe, hands)); });
+  report->add(b);
+}
+
+template <size_t HandSize>
+void bench_batch(Report* report) {
+  std::cout << "\n\nBenchmarking " << HandSize << "-card batched evaluation of pre-generated hands...\n";
+
+  const auto hands = deal_hands<HandSize>(kNumHands);
+  std::vector<uint32_t> scores(kNumHands);
+
+  Bench b;
+  b
+      .title("batch" + std::to_string(HandSize))
+      .unit("hand")
+      .warmup(10)
+      .relative(true)
+      .batch(kNumHands)
+      .minEpochIterations(20)
+      .performanceCounters(true);
+
+  for (const char* layout : kFlatLayouts) {
+    if (!have_table(table_path(layout, HandSize))) {
+      continue;
+    }
+    PokerHandEval<HandSize> phe(table_path(layout, HandSize));
+    b.run(std::string(layout) + " eval", [&]() {
+      for (size_t i = 0; i < kNumHands; i++) {
+        scores[i] = phe.eval(hands[i]);
+      }
+      doNotOptimizeAway(scores.data());
+    });
+    b.run(std::string(layout) + " eval_batch", [&]() {
+      phe.eval_batch(hands, &scores);
+      doNotOptimizeAway(scores.data());
     });
   }
+  report->add(b);
+}
+
+template <size_t HandSize>
+void bench_simd(Report* report) {
+  std::cout << "\n\nBenchmarking " << HandSize << "-card structure-of-arrays evaluation...\n";
+
+  if (!have_table(table_path("bfs", HandSize))) {
+    return;
+  }
+
+  const auto hands = deal_hands<HandSize>(kNumHands);
+  std::array<std::vector<uint32_t>, HandSize> lanes;
+  std::array<const uint32_t*, HandSize> lane_ptrs;
+  for (size_t c = 0; c < HandSize; c++) {
+    for (const auto& hand : hands) {
+      lanes[c].push_back(hand[c]);
+    }
+    lane_ptrs[c] = lanes[c].data();
+  }
+  std::vector<uint32_t> scores(kNumHands);
+
+  std::vector<std::pair<const char*, SimdIsa>> isas = {{"scalar", SimdIsa::kScalar}};
+  if (detect_simd_isa() >= SimdIsa::kAvx2) {
+    isas.push_back({"avx2", SimdIsa::kAvx2});
+  }
+  if (detect_simd_isa() >= SimdIsa::kAvx512) {
+    isas.push_back({"avx512", SimdIsa::kAvx512});
+  }
+
+  Bench b;
+  b
+      .title("simd" + std::to_string(HandSize))
+      .unit("hand")
+      .warmup(10)
+      .relative(true)
+      .batch(kNumHands)
+      .minEpochIterations(20)
+      .performanceCounters(true);
+
+  PokerHandEval<HandSize> phe(table_path("bfs", HandSize));
+  b.run("bfs eval", [&]() {
+    for (size_t i = 0; i < kNumHands; i++) {
+      scores[i] = phe.eval(hands[i]);
+    }
+    doNotOptimizeAway(scores.data());
+  });
+  for (const auto& isa : isas) {
+    b.run(std::string("bfs eval_soa ") + isa.first, [&]() {
+      phe.eval_soa(lane_ptrs, scores.data(), kNumHands, isa.second);
+      doNotOptimizeAway(scores.data());
+    });
+  }
+  report->add(b);
+}
+
+// Latency of a thread on each NUMA node walking each node's replica; remote
+// replicas should be no slower than the local one once NumaPokerHandEval
+// hands every thread its local copy.
+template <size_t HandSize>
+void bench_numa(Report* report) {
+  if (!have_table(table_path("bfs", HandSize))) {
+    return;
+  }
+
+  NumaPokerHandEval<HandSize> numa(table_path("bfs", HandSize));
+  std::cout << "\n\nBenchmarking " << HandSize << "-card hand evaluation latency on "
+            << numa.num_nodes() << " NUMA node(s)...\n";
+
+  const auto hands = deal_hands<HandSize>(kNumHands);
+
+  Bench b;
+  b
+      .title("numa" + std::to_string(HandSize))
+      .unit("hand")
+      .warmup(10)
+      .batch(kNumHands)
+      .minEpochIterations(20)
+      .performanceCounters(true);
+
+  // Run on a separate thread, so that pinning does not affect other benchmarks.
+  std::thread([&]() {
+    for (size_t cpu_node = 0; cpu_node < numa.num_nodes(); cpu_node++) {
+      numa.bind_to_node(cpu_node);
+      for (size_t table_node = 0; table_node < numa.num_nodes(); table_node++) {
+        const auto& phe = numa.replica(table_node);
+        b.run("bfs chain, cpu node " + std::to_string(numa.node_id(cpu_node)) + ", table node " +
+                  std::to_string(numa.node_id(table_node)),
+              [&]() { doNotOptimizeAway(eval_chain(phe, hands)); });
+      }
+    }
+  }).join();
+  report->add(b);
+}
+
+void bench_omaha(Report* report) {
+  std::cout << "\n\nBenchmarking Omaha (PLO4) hand evaluation...\n";
+
+  if (!have_table("tables/bfs5.phe")) {
+    return;
+  }
+  // Cards 0-4 are the board, cards 5-8 the hole cards.
+  const auto deals = deal_hands<9>(kNumHands);
+
+  Bench b;
+  b
+      .title("omaha")
+      .unit("hand")
+      .warmup(1)
+      .relative(true)
+      .batch(kNumHands)
+      .minEpochIterations(10)
+      .performanceCounters(true);
 
   {
-    PokerHandEval<HandSize> phe("tables/dfs" + std::to_string(HandSize) + ".phe");
-    b.run("dfs", [&]() {
-      ankerl::nanobench::doNotOptimizeAway(phe.eval(random_hand<HandSize>()));
+    PokerHandEval<5> phe("tables/bfs5.phe");
+    b.run("bfs5 x 60", [&]() {
+      uint32_t sum = 0;
+      for (const auto& cards : deals) {
+        uint32_t best = UINT32_MAX;
+        for (int h1 = 5; h1 < 9; h1++) {
+          for (int h2 = h1 + 1; h2 < 9; h2++) {
+            for (int i = 0; i < 5; i++) {
+              for (int j = i + 1; j < 5; j++) {
+                for (int k = j + 1; k < 5; k++) {
+                  best = std::min(best, phe.eval(cards[i], cards[j], cards[k], cards[h1], cards[h2]));
+                }
+              }
+            }
+          }
+        }
+        sum += best;
+      }
+      doNotOptimizeAway(sum);
     });
   }
 
   {
-    PokerHandEval<HandSize> phe("tables/veb" + std::to_string(HandSize) + ".phe");
-    b.run("veb", [&]() {
-      ankerl::nanobench::doNotOptimizeAway(phe.eval(random_hand<HandSize>()));
+    OmahaHandEval phe("tables/bfs5.phe");
+    b.run("omaha", [&]() {
+      uint32_t sum = 0;
+      for (const auto& cards : deals) {
+        const std::array<uint32_t, 5> board = {cards[0], cards[1], cards[2], cards[3], cards[4]};
+        const std::array<uint32_t, 4> hole = {cards[5], cards[6], cards[7], cards[8]};
+        sum += phe.eval(board, hole);
+      }
+      doNotOptimizeAway(sum);
     });
   }
+  report->add(b);
+}
+
+// Sweeps of the hands that complete a fixed prefix, as when enumerating the
+// runouts of known hole cards or of a known board.
+template <size_t HandSize>
+void bench_prefix(Report* report) {
+  std::cout << "\n\nBenchmarking " << HandSize << "-card prefix sweep throughput...\n";
+
+  Bench b;
+  b
+      .title("prefix" + std::to_string(HandSize))
+      .unit("hand")
+      .warmup(1)
+      .minEpochIterations(10)
+      .performanceCounters(true);
+
+  // Prefixes of 2, 3 and 5 cards: hole cards, a flop, hole cards and a flop.
+  const std::vector<std::vector<uint32_t>> prefixes = {{48, 49}, {0, 17, 34}, {48, 49, 0, 17, 34}};
+
+  for (const char* layout : kFlatLayouts) {
+    if (!have_table(table_path(layout, HandSize))) {
+      continue;
+    }
+    PokerHandEval<HandSize> phe(table_path(layout, HandSize));
+    for (const auto& prefix : prefixes) {
+      b.batch(choose(52 - prefix.size(), HandSize - prefix.size()));
+      b.run(std::string(layout) + " " + std::to_string(prefix.size()) + "-card prefix", [&]() {
+        phe.sweep(prefix, [](const auto&, uint32_t score) { doNotOptimizeAway(score); });
+      });
+    }
+  }
+  report->add(b);
+}
+
+// All-in equity, by exhaustive enumeration of the boards.
+void bench_equity(Report* report) {
+  std::cout << "\n\nBenchmarking all-in equity enumeration...\n";
+
+  if (!have_table(table_path("bfs", 7))) {
+    return;
+  }
+
+  struct Scenario {
+    const char* name;
+    std::vector<std::array<uint32_t, 2>> holes;
+    std::vector<uint32_t> board;
+  };
+  // AcAd, KcQc, KdKh and JsTs, on boards of 2c 6d Th Qs.
+  const std::vector<Scenario> scenarios = {
+      {"preflop heads-up", {{48, 49}, {44, 40}}, {}},
+      {"preflop 3-way", {{48, 49}, {44, 40}, {45, 46}}, {}},
+      {"flop heads-up", {{48, 49}, {39, 35}}, {0, 17, 34}},
+      {"turn heads-up", {{48, 49}, {39, 35}}, {0, 17, 34, 43}},
+  };
+  const std::vector<uint32_t> no_dead_cards;
+
+  Bench b;
+  b
+      .title("equity")
+      .unit("board")
+      .warmup(1)
+      .performanceCounters(true);
+
+  PokerHandEval<7> phe(table_path("bfs", 7));
+  for (const auto& scenario : scenarios) {
+    b.batch(phe.equity(scenario.holes, scenario.board, no_dead_cards).num_boards);
+    for (size_t num_threads : {size_t{1}, report->max_threads()}) {
+      b.run(std::string("bfs ") + scenario.name + ", " + threads_label(num_threads), [&]() {
+        doNotOptimizeAway(phe.equity(scenario.holes, scenario.board, no_dead_cards, num_threads));
+      });
+      if (report->max_threads() == 1) {
+        break;
+      }
+    }
+  }
+  report->add(b);
+}
+
+// Throughput of independent evaluations and of full sweeps, as the number of
+// threads grows.
+template <size_t HandSize>
+void bench_scaling(Report* report) {
+  std::cout << "\n\nBenchmarking " << HandSize << "-card thread scaling...\n";
+
+  if (!have_table(table_path("bfs", HandSize))) {
+    return;
+  }
 
-  const auto& results = b.results();
+  // Large enough that every thread gets a sizeable slice.
+  const auto hands = deal_hands<HandSize>(kNumHands * 16);
+  std::vector<uint32_t> scores(hands.size());
 
-  auto bfs_net = results[1].median(ankerl::nanobench::Result::Measure::elapsed) - results[0].median(ankerl::nanobench::Result::Measure::elapsed);
-  std::cout << "net bfs: " << std::setprecision(3) << (bfs_net * 1e9) << " ns/op\n";
+  Bench b;
+  b
+      .title("scaling" + std::to_string(HandSize))
+      .unit("hand")
+      .warmup(1)
+      .performanceCounters(true);
 
-  auto dfs_net = results[2].median(ankerl::nanobench::Result::Measure::elapsed) - results[0].median(ankerl::nanobench::Result::Measure::elapsed);
-  std::cout << "net dfs: " << std::setprecision(3) << (dfs_net * 1e9) << " ns/op\n";
+  PokerHandEval<HandSize> phe(table_path("bfs", HandSize));
+  for (size_t num_threads : thread_counts(report->max_threads())) {
+    b.batch(hands.size()).minEpochIterations(10);
+    b.run("bfs eval_batch, " + threads_label(num_threads), [&]() {
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+          size_t begin = hands.size() * t / num_threads;
+          size_t end = hands.size() * (t + 1) / num_threads;
+          phe.eval_batch(hands.data() + begin, scores.data() + begin, end - begin);
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      doNotOptimizeAway(scores.data());
+    });
 
-  auto veb_net = results[3].median(ankerl::nanobench::Result::Measure::elapsed) - results[0].median(ankerl::nanobench::Result::Measure::elapsed);
-  std::cout << "net veb: " << std::setprecision(3) << (veb_net * 1e9) << " ns/op\n";
+    b.batch(choose(52, HandSize)).minEpochIterations(1);
+    b.run("bfs parallel_sweep, " + threads_label(num_threads), [&]() {
+      doNotOptimizeAway(phe.parallel_sweep(
+          uint64_t{0}, [](uint64_t* sum, const auto&, uint32_t score) { *sum += score; },
+          [](uint64_t* total, uint64_t sum) { *total += sum; }, num_threads));
+    });
+  }
+  report->add(b);
 }
 
 template <size_t HandSize>
-void bench_throughput() {
+void bench_throughput(Report* report) {
   std::cout << "\n\nBenchmarking " << HandSize << "-card hand sweep throughput...\n";
 
-  ankerl::nanobench::Bench b;
+  Bench b;
   b
+      .title("sweep" + std::to_string(HandSize))
       .unit("hand")
       .warmup(10)
       .epochIterations(1)
       .batch(choose(52, HandSize))
       .performanceCounters(true);
 
-  {
-    PokerHandEval<HandSize> phe("tables/bfs" + std::to_string(HandSize) + ".phe");
-    b.run("bfs", [&]() {
-      phe.sweep([](auto, auto score) { ankerl::nanobench::doNotOptimizeAway(score); });
+  for (const char* layout : kFlatLayouts) {
+    if (!have_table(table_path(layout, HandSize))) {
+      continue;
+    }
+    PokerHandEval<HandSize> phe(table_path(layout, HandSize));
+    b.run(layout, [&]() {
+      phe.sweep([](auto, auto score) { doNotOptimizeAway(score); });
     });
   }
 
-  {
-    PokerHandEval<HandSize> phe("tables/dfs" + std::to_string(HandSize) + ".phe");
-    b.run("dfs", [&]() {
-      phe.sweep([](auto, auto score) { ankerl::nanobench::doNotOptimizeAway(score); });
+  if (have_table(table_path("bfs", HandSize))) {
+    PokerHandEval<HandSize> phe(table_path("bfs", HandSize));
+    b.run("bfs sweep_blocks", [&]() {
+      phe.sweep_blocks([](const auto&, const uint32_t* scores, uint64_t valid_cards) {
+        for (; valid_cards; valid_cards &= valid_cards - 1) {
+          doNotOptimizeAway(scores[__builtin_ctzll(valid_cards)]);
+        }
+      });
     });
   }
 
-  {
-    PokerHandEval<HandSize> phe("tables/veb" + std::to_string(HandSize) + ".phe");
-    b.run("veb", [&]() {
-      phe.sweep([](auto, auto score) { ankerl::nanobench::doNotOptimizeAway(score); });
+  if (have_table(table_path("bfs", HandSize, ".phe16"))) {
+    CompactPokerHandEval<HandSize> phe(table_path("bfs", HandSize, ".phe16"));
+    b.run("compact", [&]() {
+      phe.sweep([](auto, auto score) { doNotOptimizeAway(score); });
     });
   }
+  report->add(b);
 }
 
-int main() {
-  bench_latency<5>();
-  bench_latency<7>();
-  bench_throughput<5>();
-  bench_throughput<7>();
+// Every suite, in the order they run.
+const std::vector<std::pair<std::string, void (*)(Report*)>> kSuites = {
+    {"latency5", bench_latency<5>},
+    {"latency7", bench_latency<7>},
+    {"placement7", bench_placement<7>},
+    {"instrumentation7", bench_instrumentation<7>},
+    {"baseline5", bench_baseline<5>},
+    {"baseline7", bench_baseline<7>},
+    {"batch5", bench_batch<5>},
+    {"batch7", bench_batch<7>},
+    {"simd5", bench_simd<5>},
+    {"simd7", bench_simd<7>},
+    {"numa7", bench_numa<7>},
+    {"omaha", bench_omaha},
+    {"prefix7", bench_prefix<7>},
+    {"equity", bench_equity},
+    {"scaling5", bench_scaling<5>},
+    {"scaling7", bench_scaling<7>},
+    {"sweep5", bench_throughput<5>},
+    {"sweep7", bench_throughput<7>},
+};
+
+// Usage: benchmarks [--filter SUITE[,SUITE...]] [--threads N] [--json PATH]
+//                   [--csv PATH] [--list]
+//
+// --filter runs only the suites whose names contain one of the given
+// substrings, e.g. --filter latency,baseline. --threads caps the
+// thread-scaling suites (default: every hardware thread). --json and --csv
+// write the results of every suite that ran, tagged with the host and CPU.
+int main(int argc, char** argv) {
+  std::vector<std::string> filters;
+  size_t max_threads = std::thread::hardware_concurrency();
+  std::string json_path;
+  std::string csv_path;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--filter" && i + 1 < argc) {
+      std::istringstream list(argv[++i]);
+      for (std::string filter; std::getline(list, filter, ',');) {
+        filters.push_back(filter);
+      }
+    } else if (arg == "--threads" && i + 1 < argc) {
+      max_threads = std::stoul(argv[++i]);
+    } else if (arg == "--json" && i + 1 < argc) {
+      json_path = argv[++i];
+    } else if (arg == "--csv" && i + 1 < argc) {
+      csv_path = argv[++i];
+    } else if (arg == "--list") {
+      for (const auto& suite : kSuites) {
+        printf("%s\n", suite.first.c_str());
+      }
+      return 0;
+    } else {
+      fprintf(stderr,
+              "Usage: %s [--filter SUITE[,SUITE...]] [--threads N] [--json PATH] [--csv PATH] [--list]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  Report report(MachineInfo::detect(), std::max<size_t>(max_threads, 1));
+  for (const auto& suite : kSuites) {
+    bool selected = filters.empty() || std::any_of(filters.begin(), filters.end(), [&](const auto& filter) {
+                      return suite.first.find(filter) != std::string::npos;
+                    });
+    if (selected) {
+      suite.second(&report);
+    }
+  }
+
+  if (!json_path.empty()) {
+    report.write_json(json_path);
+  }
+  if (!csv_path.empty()) {
+    report.write_csv(csv_path);
+  }
 }
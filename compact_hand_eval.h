@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "poker_hand_eval.h"
+
+// Evaluator for compact tables (tables/*.phe16).
+//
+// Scores are below 7463 and fit in 16 bits, so the terminal rows, which make
+// up roughly half of a 7-card table, are stored as uint16_t and kept in their
+// own array. The interior rows keep 32-bit row offsets; the last interior
+// level points into the terminal array. A walk is still one add and one load
+// per card, and the 7-card table shrinks from 107 MiB to about 80 MiB.
+//
+// Example usage:
+//   CompactPokerHandEval<7> phe("/path/to/bfs7.phe16");
+//   auto score = phe.eval(37, 0, 48, 26, 7, 5, 8);
+//
+// Scores are identical to those of PokerHandEval over the same card mapping.
+template <uint8_t hand_size>
+class CompactPokerHandEval {
+ public:
+  CompactPokerHandEval(const std::string& path);
+  CompactPokerHandEval(const std::string& path, const PheLoadOptions& options);
+  CompactPokerHandEval(const CompactPokerHandEval&) = delete;
+  // The moved-from evaluator is left empty, with no table.
+  CompactPokerHandEval(CompactPokerHandEval&& other) noexcept;
+  CompactPokerHandEval& operator=(CompactPokerHandEval&& other) noexcept;
+
+  template <typename... CardType>
+  uint32_t eval(CardType... hand) const;
+
+  template <typename Container>
+  uint32_t eval(const Container& hand) const;
+
+  // Calls fn(hand, score) for every hand, as PokerHandEval::sweep.
+  template <typename Fn>
+  void sweep(Fn fn) const;
+
+ private:
+  const uint32_t* interior_ = nullptr;
+  const uint16_t* terminal_ = nullptr;
+  std::shared_ptr<const void> storage_;
+};
+
+// On-disk layout of a compact table: this header, then num_interior uint32_t
+// interior slots, then num_terminal uint16_t terminal slots.
+struct CompactPheHeader {
+  static constexpr char kMagic[8] = {'P', 'H', 'E', '1', '6', '\0', '\0', '\0'};
+  static constexpr uint32_t kVersion = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t hand_size;
+  uint32_t num_interior;
+  uint32_t num_terminal;
+};
+
+//////////////////////////////////
+// Implementation details below //
+//////////////////////////////////
+
+template <uint8_t hand_size>
+CompactPokerHandEval<hand_size>::CompactPokerHandEval(const std::string& path)
+    : CompactPokerHandEval(path, PheLoadOptions()) {}
+
+template <uint8_t hand_size>
+CompactPokerHandEval<hand_size>::CompactPokerHandEval(const std::string& path,
+                                                      const PheLoadOptions& options) {
+  size_t num_bytes = 0;
+  storage_ = details::load_table(path, options, &num_bytes);
+
+  CompactPheHeader header;
+  if (num_bytes < sizeof(header)) {
+    throw std::runtime_error(path + ": truncated compact table");
+  }
+  std::memcpy(&header, storage_.get(), sizeof(header));
+  if (std::memcmp(header.magic, CompactPheHeader::kMagic, sizeof(header.magic)) != 0 ||
+      header.version != CompactPheHeader::kVersion) {
+    throw std::runtime_error(path + ": not a compact table");
+  }
+  if (header.hand_size != hand_size) {
+    throw std::runtime_error(path + ": table is for a different hand size");
+  }
+  if (num_bytes != sizeof(header) + header.num_interior * sizeof(uint32_t) +
+                       header.num_terminal * sizeof(uint16_t)) {
+    throw std::runtime_error(path + ": truncated compact table");
+  }
+
+  const char* data = static_cast<const char*>(storage_.get()) + sizeof(header);
+  interior_ = reinterpret_cast<const uint32_t*>(data);
+  terminal_ = reinterpret_cast<const uint16_t*>(data + header.num_interior * sizeof(uint32_t));
+}
+
+template <uint8_t hand_size>
+CompactPokerHandEval<hand_size>::CompactPokerHandEval(CompactPokerHandEval&& other) noexcept
+    : interior_(std::exchange(other.interior_, nullptr)),
+      terminal_(std::exchange(other.terminal_, nullptr)),
+      storage_(std::move(other.storage_)) {}
+
+template <uint8_t hand_size>
+CompactPokerHandEval<hand_size>& CompactPokerHandEval<hand_size>::operator=(
+    CompactPokerHandEval&& other) noexcept {
+  if (this != &other) {
+    interior_ = std::exchange(other.interior_, nullptr);
+    terminal_ = std::exchange(other.terminal_, nullptr);
+    storage_ = std::move(other.storage_);
+  }
+  return *this;
+}
+
+template <uint8_t hand_size>
+template <typename... CardType>
+uint32_t CompactPokerHandEval<hand_size>::eval(CardType... hand) const {
+  static_assert(sizeof...(hand) == hand_size, "Wrong number of arguments.");
+  const uint32_t cards[] = {static_cast<uint32_t>(hand)...};
+  return eval(cards);
+}
+
+template <uint8_t hand_size>
+template <typename Container>
+uint32_t CompactPokerHandEval<hand_size>::eval(const Container& hand) const {
+  auto it = std::begin(hand);
+  uint32_t index = 0;
+  for (uint8_t i = 0; i + 1 < hand_size; i++, ++it) {
+    index = interior_[index + *it];
+  }
+  return terminal_[index + *it];
+}
+
+template <uint8_t hand_size>
+template <typename Fn>
+void CompactPokerHandEval<hand_size>::sweep(Fn fn) const {
+  static_assert(hand_size >= 2, "Compact tables need at least one interior level.");
+
+  uint32_t deck[52];
+  for (uint32_t c = 0; c < 52; c++) {
+    deck[c] = c;
+  }
+
+  // Walk the interior levels as usual, then read each terminal row as a run.
+  uint32_t stack[hand_size] = {};
+  std::array<uint32_t, hand_size> hand;
+  auto finish = [&](std::array<uint32_t, hand_size>& h, uint32_t row) {
+    const uint16_t* scores = terminal_ + row;
+    for (uint32_t card = h[hand_size - 2] + 1; card < 52; card++) {
+      h[hand_size - 1] = card;
+      fn(static_cast<const std::array<uint32_t, hand_size>&>(h), uint32_t{scores[card]});
+    }
+  };
+  details::sweep_deck<hand_size - 1>(interior_, hand, stack, 0, deck, 0, 52, finish);
+}
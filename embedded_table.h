@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Tables linked into the binary, for processes that cannot afford to find and
+// read a *.phe file before their first evaluation.
+//
+// `make bin/embedded_bfs7.o` assembles tables/bfs7.phe into an object file
+// (see embedded_table.S); link it in, and declare the table once per
+// namespace scope that uses it:
+//   #include "embedded_table.h"
+//   PHE_EMBEDDED_TABLE(bfs7);
+//
+//   PokerHandEval<7> phe(phe_table_bfs7, phe_table_bfs7_size());
+//
+// The table lives in the read-only data of the executable: construction does
+// no I/O and no copy, pages fault in from the page cache on first touch, and
+// every process running the same binary shares them.
+//
+// Small tables can also be compiled in as a constexpr array, generated by
+// `make tables/bfs5_table.h` (see generate_tables/phe_embed.cc).
+#define PHE_EMBEDDED_TABLE(name)                                               \
+  extern "C" const uint32_t phe_table_##name[];                                \
+  extern "C" const uint32_t phe_table_##name##_end[];                          \
+  inline size_t phe_table_##name##_size() {                                    \
+    return static_cast<size_t>(phe_table_##name##_end - phe_table_##name);     \
+  }
@@ -58,6 +58,16 @@ struct Hand {
 template <typename T>
 using MapCardTo = std::array<T, 52>;
 
+// Describes how cards decompose into ranks and suits.
+// Only suit-canonical tables need this: they rely on every hand keeping its
+// valuation when its suits are relabeled.
+struct CardSuits {
+  // The suit, in [0, 4), of each card.
+  MapCardTo<uint8_t> suit;
+  // with_suit[card][s] is the card with the same rank as `card` and suit s.
+  MapCardTo<std::array<Card, 4>> with_suit;
+};
+
 // Function that returns the valuation of a completed hand of cards.
 // This is used as a bootstrap to construct a more efficient evaluator.
 // This is the only place where card values, integers in the range [0, 52),
@@ -69,4 +79,32 @@ using EvalFn = std::function<Score(const Hand&)>;
 void for_each_hand(uint8_t desired_hand_size,
                    std::function<void(const Hand&)> fn);
 
+// Binomial coefficients: kChoose[n][k] is n choose k, for n <= 52, k <= 7.
+inline constexpr std::array<std::array<uint32_t, 8>, 53> kChoose = [] {
+  std::array<std::array<uint32_t, 8>, 53> choose = {};
+  for (size_t n = 0; n <= 52; n++) {
+    choose[n][0] = 1;
+    for (size_t k = 1; k < 8 && k <= n; k++) {
+      choose[n][k] = choose[n - 1][k - 1] + (k < n ? choose[n - 1][k] : 0);
+    }
+  }
+  return choose;
+}();
+
+// Number of distinct hands of the given size.
+inline uint32_t num_hands_of_size(uint8_t hand_size) {
+  return kChoose[52][hand_size];
+}
+
+// Returns the combinatorial (colex) rank of a sorted hand, in
+// [0, num_hands_of_size(hand.size)). Hands of the same size have distinct
+// ranks, so the rank can index dense per-size arrays.
+inline uint32_t colex_rank(const Hand& hand) {
+  uint32_t rank = 0;
+  for (uint8_t i = 0; i < hand.size; i++) {
+    rank += kChoose[hand.cards[i]][i + 1];
+  }
+  return rank;
+}
+
 }  // namespace poker_eval
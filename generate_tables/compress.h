@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "poker_hand_eval.h"
+
+namespace poker_eval {
+
+// Describes a table for the header of its compressed file.
+struct CompressedTableInfo {
+  uint32_t hand_size = 0;
+  std::string layout;
+  std::string card_mapping = "rank-major";
+  std::string score_semantics = "cactus-kev";
+  // Rows decoded by one task; the unit of parallelism when loading.
+  uint32_t rows_per_chunk = 4096;
+};
+
+// Encodes `table`, a flattened FSM of 52-slot rows, in the compressed format
+// described by PheCompressedHeader, and writes it to `path`. Chunks are
+// encoded on num_threads threads (0 means one per hardware thread).
+void save_compressed_lookup_table(const std::vector<uint32_t>& table,
+                                  const CompressedTableInfo& info,
+                                  const std::string& path,
+                                  size_t num_threads = 0);
+
+//////////////////////////////////
+// Implementation details below //
+//////////////////////////////////
+
+namespace compress_details {
+
+inline uint32_t bit_width(uint32_t value) {
+  return value == 0 ? 0 : 32 - __builtin_clz(value);
+}
+
+// Appends bit fields, LSB first, to a byte buffer.
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>* out) : out_(out) {}
+  ~BitWriter() { flush(); }
+
+  void write(uint32_t value, uint32_t bits) {
+    buffer_ |= uint64_t{value} << num_bits_;
+    num_bits_ += bits;
+    while (num_bits_ >= 8) {
+      out_->push_back(static_cast<uint8_t>(buffer_));
+      buffer_ >>= 8;
+      num_bits_ -= 8;
+    }
+  }
+
+  // Pads the last partial byte with zeros.
+  void flush() {
+    if (num_bits_ > 0) {
+      out_->push_back(static_cast<uint8_t>(buffer_));
+      buffer_ = 0;
+      num_bits_ = 0;
+    }
+  }
+
+ private:
+  std::vector<uint8_t>* out_;
+  uint64_t buffer_ = 0;
+  uint32_t num_bits_ = 0;
+};
+
+// Appends the smaller of the two encodings of one row, as read back by
+// details::decode_row.
+inline void encode_row(const uint32_t* row, std::vector<uint8_t>* out) {
+  uint32_t base = *std::min_element(row, row + 52);
+  bool scaled = true;
+  for (uint32_t card = 0; card < 52; card++) {
+    scaled = scaled && (row[card] - base) % 52 == 0;
+  }
+  uint32_t scale = scaled ? 52 : 1;
+
+  std::vector<uint32_t> values(row, row + 52);
+  std::sort(values.begin(), values.end());
+  values.erase(std::unique(values.begin(), values.end()), values.end());
+
+  uint32_t value_bits = bit_width((values.back() - base) / scale);
+  uint32_t index_bits = bit_width(values.size() - 1);
+  size_t for_bits = 52 * value_bits;
+  size_t dictionary_bits = 8 + values.size() * value_bits + 52 * index_bits;
+  bool dictionary = dictionary_bits < for_bits;
+
+  out->push_back((dictionary ? details::kRowDictionary : 0) | (scaled ? details::kRowScaled : 0));
+  out->push_back(value_bits);
+  out->insert(out->end(), reinterpret_cast<const uint8_t*>(&base),
+              reinterpret_cast<const uint8_t*>(&base) + sizeof(base));
+
+  if (dictionary) {
+    out->push_back(values.size() - 1);
+    BitWriter writer(out);
+    for (uint32_t value : values) {
+      writer.write((value - base) / scale, value_bits);
+    }
+    for (uint32_t card = 0; card < 52; card++) {
+      uint32_t index = std::lower_bound(values.begin(), values.end(), row[card]) - values.begin();
+      writer.write(index, index_bits);
+    }
+  } else {
+    BitWriter writer(out);
+    for (uint32_t card = 0; card < 52; card++) {
+      writer.write((row[card] - base) / scale, value_bits);
+    }
+  }
+}
+
+inline void copy_label(const std::string& label, char (&out)[16], const char* what) {
+  if (label.size() >= sizeof(out)) {
+    throw std::invalid_argument(std::string("compressed table ") + what + " too long: " + label);
+  }
+  std::memset(out, 0, sizeof(out));
+  std::memcpy(out, label.data(), label.size());
+}
+
+}  // namespace compress_details
+
+inline void save_compressed_lookup_table(const std::vector<uint32_t>& table,
+                                         const CompressedTableInfo& info,
+                                         const std::string& path,
+                                         size_t num_threads) {
+  if (table.size() % 52 != 0) {
+    throw std::invalid_argument("save_compressed_lookup_table: table is not made of 52-slot rows");
+  }
+  if (info.rows_per_chunk == 0) {
+    throw std::invalid_argument("save_compressed_lookup_table: rows_per_chunk must be positive");
+  }
+
+  PheCompressedHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, PheCompressedHeader::kMagic, sizeof(header.magic));
+  header.version = PheCompressedHeader::kVersion;
+  header.hand_size = info.hand_size;
+  compress_details::copy_label(info.layout, header.layout, "layout");
+  compress_details::copy_label(info.card_mapping, header.card_mapping, "card mapping");
+  compress_details::copy_label(info.score_semantics, header.score_semantics, "score semantics");
+  header.num_entries = table.size();
+  header.rows_per_chunk = info.rows_per_chunk;
+
+  uint64_t num_rows = table.size() / 52;
+  header.num_chunks = (num_rows + info.rows_per_chunk - 1) / info.rows_per_chunk;
+
+  std::vector<std::vector<uint8_t>> encoded(header.num_chunks);
+  std::vector<PheCompressedChunk> chunks(header.num_chunks);
+  details::run_work_stealing(header.num_chunks, details::resolve_num_threads(num_threads), [&](size_t, size_t chunk) {
+    uint64_t first_row = chunk * uint64_t{info.rows_per_chunk};
+    uint64_t last_row = std::min(first_row + info.rows_per_chunk, num_rows);
+    for (uint64_t row = first_row; row < last_row; row++) {
+      compress_details::encode_row(&table[row * 52], &encoded[chunk]);
+    }
+    chunks[chunk].num_bytes = encoded[chunk].size();
+    chunks[chunk].checksum = details::table_checksum(&table[first_row * 52],
+                                                     (last_row - first_row) * 52 * sizeof(uint32_t));
+  });
+
+  uint64_t offset = sizeof(header) + chunks.size() * sizeof(PheCompressedChunk);
+  for (auto& chunk : chunks) {
+    chunk.offset = offset;
+    offset += chunk.num_bytes;
+  }
+  header.checksum = details::compressed_header_checksum(header, chunks);
+
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(chunks.data()), chunks.size() * sizeof(PheCompressedChunk));
+  for (const auto& bytes : encoded) {
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  }
+  file.close();
+  if (!file) {
+    throw std::runtime_error("write " + path + " failed");
+  }
+}
+
+}  // namespace poker_eval
@@ -1,7 +1,7 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
-#include <unordered_map>
 
 #include "generate_tables/common.h"
 
@@ -13,15 +13,86 @@ namespace poker_eval {
 // After hand_size hops, the state becomes the score.
 //
 // fsm[card_0][card_1][card_2]...[card_(max_hand_size-1)] -> score
-using FSM = std::unordered_map<EncodedHand, MapCardTo<HandOrScore>>;
+//
+// States are stored densely: for each hand size, a vector indexed by the colex
+// rank of the representative hand locates the state's edges.
+class FSM {
+ public:
+  // Whether the given hand is a state.
+  bool contains(HandOrScore hand) const;
+
+  // The out edges of the given state. Throws std::out_of_range if the hand is
+  // not a state.
+  const MapCardTo<HandOrScore>& at(HandOrScore hand) const;
+
+  // The score of the given state, for FSMs built with scored intermediate
+  // states (see build_unified_fsm), or 0. Throws std::out_of_range if the
+  // hand is not a state.
+  Score score(HandOrScore hand) const;
+
+  // Number of states.
+  size_t size() const { return edges_.size(); }
+
+  // Adds a state with the given out edges, and optionally its own score.
+  void insert(EncodedHand hand, const MapCardTo<HandOrScore>& edges, Score score = 0);
+
+ private:
+  static constexpr uint32_t kNoState = UINT32_MAX;
+
+  // Returns the index into edges_ of the given hand, or kNoState.
+  uint32_t find(HandOrScore hand) const;
+
+  // state_of_rank_[size][colex_rank(hand)] is the index into edges_ of the
+  // state with representative hand, or kNoState.
+  std::vector<std::vector<uint32_t>> state_of_rank_;
+  std::vector<MapCardTo<HandOrScore>> edges_;
+  std::vector<Score> scores_;
+};
 
 // Builds a finite-state-machine for hands of the current size, using the given
 // evaluation function.
 //
+// Hands are processed on num_threads threads (0 means one per hardware
+// thread), so eval_fn must be safe to call concurrently. The result does not
+// depend on num_threads.
+//
 // Note: for efficiency reasons, hand representations are compacted and
 // hand_size cannot exceed seven.
 template <uint8_t hand_size>
-FSM build_fsm(EvalFn eval_fn);
+FSM build_fsm(EvalFn eval_fn, size_t num_threads = 0);
+
+// Builds a finite-state-machine over suit-canonical hands only.
+//
+// A hand is suit-canonical if the suits it uses are exactly {0, ..., m-1}.
+// Evaluators relabel suits in order of first appearance (the first suit seen
+// becomes suit 0, the next new suit becomes suit 1, ...), so every hand they
+// walk is suit-canonical, and a state never sees a card whose suit is more
+// than one past the suits already used. All other transitions become
+// don't-cares, which lets, e.g., every single-suited flush draw share a
+// state.
+template <uint8_t hand_size>
+FSM build_suit_canonical_fsm(EvalFn eval_fn, const CardSuits& card_suits, size_t num_threads = 0);
+
+// Builds a finite-state-machine whose intermediate states, for hands of at
+// least min_scored_size cards, also carry the score of the hand so far. A
+// single table then evaluates hands of any size in
+// [min_scored_size, max_hand_size]. eval_fn must accept all of those sizes.
+//
+// Hands only share a state if their scores match, so the FSM has somewhat
+// more states than that of build_fsm<max_hand_size>.
+template <uint8_t max_hand_size>
+FSM build_unified_fsm(EvalFn eval_fn, uint8_t min_scored_size, size_t num_threads = 0);
+
+// The relabeling side channel of a suit-canonical table is itself a small
+// state machine, whose states are the ordered sequences of distinct suits
+// seen so far: 1 + 4 + 12 + 24 + 24 of them.
+constexpr uint32_t kNumSuitPermStates = 65;
+
+// Builds the relabeling side channel of a suit-canonical table.
+// Entry [perm_state * 52 + card] holds
+//   (next_perm_state << 6) | canonical_card,
+// starting from perm_state 0.
+inline std::vector<uint16_t> build_suit_relabel_table(const CardSuits& card_suits);
 
 }  // namespace poker_eval
 
@@ -1,7 +1,68 @@
-#include <unordered_set>
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include "poker_hand_eval.h"
 
 namespace poker_eval {
 
+inline uint32_t FSM::find(HandOrScore encoded) const {
+  // Scores share the key space with encoded hands, so reject anything that
+  // is not the encoding of a sorted hand.
+  Hand hand = Hand::decode(encoded);
+  if (hand.size >= state_of_rank_.size() || state_of_rank_[hand.size].empty()) {
+    return kNoState;
+  }
+  for (uint8_t i = 0; i < 7; i++) {
+    if (i < hand.size ? (hand.cards[i] >= 52 || (i > 0 && hand.cards[i] <= hand.cards[i - 1]))
+                      : hand.cards[i] != 0) {
+      return kNoState;
+    }
+  }
+  return state_of_rank_[hand.size][colex_rank(hand)];
+}
+
+inline bool FSM::contains(HandOrScore hand) const {
+  return find(hand) != kNoState;
+}
+
+inline const MapCardTo<HandOrScore>& FSM::at(HandOrScore hand) const {
+  uint32_t state = find(hand);
+  if (state == kNoState) {
+    throw std::out_of_range("FSM::at: not a state");
+  }
+  return edges_[state];
+}
+
+inline Score FSM::score(HandOrScore hand) const {
+  uint32_t state = find(hand);
+  if (state == kNoState) {
+    throw std::out_of_range("FSM::score: not a state");
+  }
+  return scores_[state];
+}
+
+inline void FSM::insert(EncodedHand encoded, const MapCardTo<HandOrScore>& edges, Score score) {
+  Hand hand = Hand::decode(encoded);
+  if (state_of_rank_.size() <= hand.size) {
+    state_of_rank_.resize(hand.size + 1);
+  }
+  auto& state_of_rank = state_of_rank_[hand.size];
+  if (state_of_rank.empty()) {
+    state_of_rank.assign(num_hands_of_size(hand.size), kNoState);
+  }
+  state_of_rank[colex_rank(hand)] = edges_.size();
+  edges_.push_back(edges);
+  scores_.push_back(score);
+}
+
 // Whether the given card-keyed associative container contains the given card.
 template <typename T>
 inline bool has_card(const MapCardTo<T>& c, Card k) {
@@ -43,12 +104,55 @@ inline void for_each_next_hand(const Hand& hand,
   }
 }
 
+// Whether the suits used by the hand are exactly {0, ..., m-1}, for some m.
+inline bool is_suit_canonical(const Hand& hand, const CardSuits& card_suits) {
+  uint32_t suit_mask = 0;
+  for (uint8_t i = 0; i < hand.size; i++) {
+    suit_mask |= 1u << card_suits.suit[hand.cards[i]];
+  }
+  return (suit_mask & (suit_mask + 1)) == 0;
+}
+
 // Mapping from a hand to a representative of the equivalence class.
 // For example, if there are two seven-card hands that both use the same five
 // cards for evaluation (and the other two cards don't matter), one may be
 // arbitrarily set as a common representative for both.
 // This is used to help collapse multiple states in the finite-state-machine.
-using ToRepresentativeHand = std::unordered_map<EncodedHand, EncodedHand>;
+//
+// Hands of each size are stored densely: each hand, by colex rank, maps to
+// the ID of its equivalence class, and each class ID to its representative.
+class ToRepresentativeHand {
+ public:
+  static constexpr uint32_t kNoClass = UINT32_MAX;
+
+  // Returns the representative of the hand's equivalence class, or 0 if the
+  // hand has none, e.g. because it is not suit-canonical.
+  EncodedHand find(const Hand& hand) const {
+    const Level& level = levels_[hand.size];
+    uint32_t class_id = level.class_of_rank[colex_rank(hand)];
+    return class_id == kNoClass ? 0 : level.representatives[class_id];
+  }
+
+  // Sets the equivalence classes of hands of the given size.
+  // class_of_rank[colex_rank(hand)] is the class ID of hand, or kNoClass.
+  void set_classes(uint8_t hand_size,
+                   std::vector<uint32_t> class_of_rank,
+                   std::vector<EncodedHand> representatives) {
+    levels_[hand_size] = {std::move(class_of_rank), std::move(representatives)};
+  }
+
+  // Frees the equivalence classes of hands of the given size.
+  void clear_classes(uint8_t hand_size) {
+    levels_[hand_size] = {};
+  }
+
+ private:
+  struct Level {
+    std::vector<uint32_t> class_of_rank;
+    std::vector<EncodedHand> representatives;
+  };
+  std::array<Level, 8> levels_;
+};
 
 // Edges are the transitions emitting from a state. Each state has 52 out-edges
 // (less for repeated cards) that point to another state.
@@ -71,9 +175,14 @@ inline bool edges_compatible(const Edges& edge_set_1, const Edges& edge_set_2) {
 
 // An equivalence class, here, is a collections of hands that have a compatible
 // set of edges, e.g. hands that react identically to every future card.
+// The hands themselves are tracked by class ID, in a dense vector indexed by
+// colex rank; the first hand added represents the class.
+// In FSMs with scored intermediate states, all hands of a class also share
+// their own score; it is 0 otherwise.
 struct EquivalenceClass {
-  std::unordered_set<EncodedHand> hands;
+  EncodedHand representative_hand;
   Edges edges;
+  Score score;
 };
 
 // EquivalenceClass objects are maintained in a master std::vector.
@@ -84,141 +193,367 @@ using EquivalenceClassIndex = int32_t;
 // list.
 const EquivalenceClassIndex EquivalenceClassNotFound = -1;
 
+// hints[card][target] lists, in creation order, the equivalence classes whose
+// card-transition leads to target.
 using EquivalenceClassHintMap =
-  MapCardTo<std::unordered_map<HandOrScore, std::unordered_set<EquivalenceClassIndex>>>;
+  MapCardTo<std::unordered_map<HandOrScore, std::vector<EquivalenceClassIndex>>>;
 
 // Populates a given equivalence_class with the given edges.
-// Excludes not-defined transitions and updates the hint map.
+// Excludes not-defined transitions and updates the hint map. The edges must
+// be compatible with the class, so only transitions the class did not define
+// yet are new, and each class is listed at most once per hint.
 inline void populate_equivalence_class_edges(const Edges& edges,
                                              EquivalenceClass* equivalence_class,
                                              EquivalenceClassIndex equivalence_class_idx,
                                              EquivalenceClassHintMap* equivalence_class_hints) {
   for (Card card = 0; card < 52; card++) {
-    if (has_card(edges, card)) {
+    if (has_card(edges, card) && !has_card(equivalence_class->edges, card)) {
       HandOrScore target = edges[card];
       equivalence_class->edges[card] = target;
-      (*equivalence_class_hints)[card][target].insert(equivalence_class_idx);
+      (*equivalence_class_hints)[card][target].push_back(equivalence_class_idx);
     }
   }
 }
 
-// Selects a representative hand to describe the equivalence class and populates
-// associated data structures.
-inline EncodedHand collapse_equivalence_class(
-    const EquivalenceClass& equivalence_class,
-    ToRepresentativeHand* representative_hand_map) {
-  // Choose an arbitrary hand to act as the representative.
-  EncodedHand representative_hand = *equivalence_class.hands.begin();
-
-  // Update the representative hand map, so that all hands in the equivalence
-  // class point to the same representative hand.
-  for (EncodedHand hand : equivalence_class.hands) {
-    (*representative_hand_map)[hand] = representative_hand;
-  }
-
-  return representative_hand;
-}
-
 // Add the equivalence_class to the final finite-state-machine.
 inline void add_equivalence_class_to_fsm(const EquivalenceClass& equivalence_class,
-                                         EncodedHand representative_hand,
                                          FSM* fsm) {
   // Add the representative hand and the equivalence class's collective edges to
-  // the final finite-state-machine.
-  for (Card card = 0; card < 52; card++) {
-    if (has_card(equivalence_class.edges, card)) {
-      (*fsm)[representative_hand][card] = equivalence_class.edges[card];
+  // the final finite-state-machine. Undefined transitions are already 0.
+  fsm->insert(equivalence_class.representative_hand, equivalence_class.edges, equivalence_class.score);
+}
+
+// Computes the out edges of a hand.
+// Only reads the representative hand map, so hands of the same size may be
+// processed concurrently.
+inline Edges compute_edges(const Hand& hand,
+                           uint8_t max_hand_size,
+                           const EvalFn& eval_fn,
+                           const CardSuits* card_suits,
+                           const ToRepresentativeHand& representative_hand_map) {
+  Edges edges;
+  edges.fill(0);
+
+  for_each_next_hand(hand, [&](Card card, const Hand& next_hand) {
+    if (card_suits && !is_suit_canonical(next_hand, *card_suits)) {
+      // Never walked; left as a don't-care transition.
+      return;
+    }
+    if (next_hand.size == max_hand_size) {
+      // Hands of max size have an implicit state based on their evaluated
+      // score.
+      edges[card] = eval_fn(next_hand);
+    } else {
+      edges[card] = representative_hand_map.find(next_hand);
+    }
+  });
+
+  return edges;
+}
+
+// Adds a hand, with the given out edges and own score, to a compatible
+// equivalence class with the same score.
+//
+// If one is found, the hand is added to the equivalence class and the class's
+// out edges are updated. The update is because out edges may contain
+// `don't-care` connections that are collapsed into a single state.
+// Otherwise, a new equivalence class is created.
+//
+// The result depends on the order in which hands are added.
+inline void add_hand_to_equivalence_classes(const Hand& hand,
+                                            const Edges& edges,
+                                            Score score,
+                                            std::vector<EquivalenceClass>* equivalence_classes,
+                                            EquivalenceClassHintMap* equivalence_class_hints,
+                                            std::vector<uint32_t>* class_of_rank) {
+  // Choose a definitive equivalence class for the hand.
+  EquivalenceClassIndex equivalence_class_idx = EquivalenceClassNotFound;
+  bool match_found = false;
+  for (Card card = 0; card < 52 && !match_found; card++) {
+    if (edges[card] == 0) {
+      continue;
+    }
+
+    for (auto idx : (*equivalence_class_hints)[card][edges[card]]) {
+      const EquivalenceClass& candidate = (*equivalence_classes)[idx];
+      if (candidate.score == score && edges_compatible(edges, candidate.edges)) {
+        equivalence_class_idx = idx;
+        match_found = true;
+        break;
+      }
     }
   }
+
+  // If no valid equivalence class exists, make a new one, represented by the
+  // current hand.
+  if (equivalence_class_idx == EquivalenceClassNotFound) {
+    equivalence_classes->push_back({hand.encode(), {}, score});
+    equivalence_class_idx = equivalence_classes->size() - 1;
+  }
+
+  // Add the hand to the equivalence class.
+  EquivalenceClass* matched_equivalence_class = &(*equivalence_classes)[equivalence_class_idx];
+  (*class_of_rank)[colex_rank(hand)] = equivalence_class_idx;
+
+  // Update the equivalence class.
+  populate_equivalence_class_edges(edges, matched_equivalence_class, equivalence_class_idx, equivalence_class_hints);
 }
 
+// Number of hands whose edges are computed in one parallel pass.
+constexpr size_t kEdgeChunkSize = 1 << 16;
+
+// A fixed set of threads that run pass_fn(thread_idx) once per pass. Threads
+// are started once and wait between passes, rather than being created anew
+// for every chunk of hands.
+class PassWorkers {
+ public:
+  PassWorkers(size_t num_threads, std::function<void(size_t)> pass_fn) : pass_fn_(std::move(pass_fn)) {
+    for (size_t t = 0; t < num_threads; t++) {
+      threads_.emplace_back(&PassWorkers::work, this, t);
+    }
+  }
+
+  ~PassWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Starts a pass on every thread, and returns without waiting for it.
+  void start() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pass_++;
+      num_running_ = threads_.size();
+    }
+    start_.notify_all();
+  }
+
+  // Waits for the pass in progress, if any, to finish.
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&]() { return num_running_ == 0; });
+  }
+
+ private:
+  void work(size_t thread_idx) {
+    uint64_t seen_pass = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [&]() { return stop_ || pass_ != seen_pass; });
+        if (stop_) {
+          return;
+        }
+        seen_pass = pass_;
+      }
+      pass_fn_(thread_idx);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--num_running_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  std::function<void(size_t)> pass_fn_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  uint64_t pass_ = 0;
+  size_t num_running_ = 0;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
 // Populates the representative hand map and finite-state-machine with the
 // equivalence classes for hands of the given size.
 //
 // This requires that equivalence classes have been already been built up for
 // hands of size hand_size+1. Hands with hand_size == max_hand_size are
 // implicitly collapsed based on the given eval_fn.
+//
+// If card_suits is given, only suit-canonical hands are considered. If
+// hand_size is at least min_scored_size, each state also carries the
+// eval_fn score of its hands; pass max_hand_size for no scored states.
+//
+// Hands are processed in chunks. The out edges of a chunk, which dominate the
+// cost, are computed on num_threads threads, while the previous chunk is
+// merged into equivalence classes on the calling thread. Merging always
+// follows hand order, so the result does not depend on num_threads.
+// eval_fn must be safe to call concurrently.
 inline void build_hands_of_size(uint8_t hand_size,
                                 uint8_t max_hand_size,
+                                uint8_t min_scored_size,
                                 EvalFn eval_fn,
+                                const CardSuits* card_suits,
+                                size_t num_threads,
                                 ToRepresentativeHand* representative_hand_map,
                                 FSM* fsm) {
   std::vector<EquivalenceClass> equivalence_classes;
   EquivalenceClassHintMap equivalence_class_hints;
+  std::vector<uint32_t> class_of_rank(num_hands_of_size(hand_size), ToRepresentativeHand::kNoClass);
 
-  // For each hand, we collect the out edges and try to find a valid matching
-  // equivalence class.
-  // If one is found, the hand is added to the equivalence class and the class's
-  // out edges are updated. The update is because out edges may contain
-  // `don't-care` connections that are collapsed into a single state.
-  // Otherwise, a new equivalence class is created.
-  for_each_hand(hand_size, [&](const Hand& hand) {
-    Edges edges;
-    edges.fill(0);
-
-    // Populate out edges.
-    for_each_next_hand(hand, [&](Card card, const Hand& next_hand) {
-      if (next_hand.size == max_hand_size) {
-        // Hands of max size have an implicit state based on their evaluated
-        // score.
-        edges[card] = eval_fn(next_hand);
-      } else {
-        edges[card] = (*representative_hand_map)[next_hand.encode()];
-      }
-    });
+  const bool scored = hand_size >= min_scored_size;
 
-    // Choose a definitive equivalence class for the hand.
-    EquivalenceClassIndex equivalence_class_idx = EquivalenceClassNotFound;
-    bool match_found = false;
-    for (Card card = 0; card < 52 && !match_found; card++) {
-      if (edges[card] == 0) {
-        continue;
-      }
+  std::vector<Hand> pending_hands;
+  std::vector<Edges> pending_edges;
+  std::vector<Score> pending_scores;
+  std::vector<Hand> merging_hands;
+  std::vector<Edges> merging_edges;
+  std::vector<Score> merging_scores;
 
-      for (auto idx : equivalence_class_hints[card][edges[card]]) {
-        if (edges_compatible(edges, equivalence_classes[idx].edges)) {
-          equivalence_class_idx = idx;
-          match_found = true;
-          break;
-        }
+  auto compute_chunk_edges = [&](size_t thread_idx) {
+    size_t begin = pending_hands.size() * thread_idx / num_threads;
+    size_t end = pending_hands.size() * (thread_idx + 1) / num_threads;
+    for (size_t i = begin; i < end; i++) {
+      pending_edges[i] = compute_edges(pending_hands[i], max_hand_size, eval_fn, card_suits, *representative_hand_map);
+      if (scored) {
+        pending_scores[i] = eval_fn(pending_hands[i]);
       }
     }
+  };
+  // With a single thread, chunks are computed inline instead.
+  std::unique_ptr<PassWorkers> workers;
+  if (num_threads > 1) {
+    workers = std::make_unique<PassWorkers>(num_threads, compute_chunk_edges);
+  }
 
-    // If no valid equivalence class exists, make a new one.
-    // We add the current hand to the equivalence class later.
-    if (equivalence_class_idx == EquivalenceClassNotFound) {
-      equivalence_classes.push_back({{}, edges});
-      equivalence_class_idx = equivalence_classes.size() - 1;
+  // Computes the edges of the pending chunk, merges the previous chunk, and
+  // moves the pending chunk up for merging.
+  auto advance = [&]() {
+    pending_edges.assign(pending_hands.size(), Edges());
+    pending_scores.assign(pending_hands.size(), Score());
+    if (workers) {
+      workers->start();
+    } else {
+      compute_chunk_edges(0);
     }
 
-    // Add the hand to the equivalence class.
-    EquivalenceClass* matched_equivalence_class = &equivalence_classes[equivalence_class_idx];
-    matched_equivalence_class->hands.insert(hand.encode());
+    for (size_t i = 0; i < merging_hands.size(); i++) {
+      add_hand_to_equivalence_classes(merging_hands[i], merging_edges[i], merging_scores[i],
+                                      &equivalence_classes, &equivalence_class_hints, &class_of_rank);
+    }
 
-    // Update the equivalence class.
-    populate_equivalence_class_edges(edges, matched_equivalence_class, equivalence_class_idx, &equivalence_class_hints);
+    if (workers) {
+      workers->wait();
+    }
+    merging_hands.swap(pending_hands);
+    merging_edges.swap(pending_edges);
+    merging_scores.swap(pending_scores);
+    pending_hands.clear();
+  };
+
+  for_each_hand(hand_size, [&](const Hand& hand) {
+    if (card_suits && !is_suit_canonical(hand, *card_suits)) {
+      return;
+    }
+    pending_hands.push_back(hand);
+    if (pending_hands.size() == kEdgeChunkSize) {
+      advance();
+    }
   });
+  // Drain the last two chunks.
+  advance();
+  advance();
 
   // Add all equivalence classes, for the current hand size, to the
-  // finite-state-machine.
+  // finite-state-machine, and point every hand at its representative. Larger
+  // hands are no longer needed.
+  std::vector<EncodedHand> representatives;
+  representatives.reserve(equivalence_classes.size());
   for (auto&& equivalence_class : equivalence_classes) {
-    EncodedHand representative_hand = collapse_equivalence_class(equivalence_class, representative_hand_map);
-    add_equivalence_class_to_fsm(equivalence_class, representative_hand, fsm);
+    add_equivalence_class_to_fsm(equivalence_class, fsm);
+    representatives.push_back(equivalence_class.representative_hand);
   }
+  representative_hand_map->set_classes(hand_size, std::move(class_of_rank), std::move(representatives));
+  representative_hand_map->clear_classes(hand_size + 1);
   printf("  found %zu equivalence classes.\n", equivalence_classes.size());
 }
 
 template <uint8_t max_hand_size>
-FSM build_fsm(EvalFn eval_fn) {
+FSM build_fsm(EvalFn eval_fn, size_t num_threads) {
+  num_threads = details::resolve_num_threads(num_threads);
   FSM fsm;
   ToRepresentativeHand representative_hand_map;
 
   for (int hand_size = max_hand_size - 1; hand_size >= 0; hand_size--) {
     printf("  Processing hands of size: %d...", hand_size);
-    build_hands_of_size(hand_size, max_hand_size, eval_fn, &representative_hand_map, &fsm);
+    build_hands_of_size(hand_size, max_hand_size, max_hand_size, eval_fn, nullptr, num_threads,
+                        &representative_hand_map, &fsm);
   }
 
   return fsm;
 }
 
+template <uint8_t max_hand_size>
+FSM build_suit_canonical_fsm(EvalFn eval_fn, const CardSuits& card_suits, size_t num_threads) {
+  num_threads = details::resolve_num_threads(num_threads);
+  FSM fsm;
+  ToRepresentativeHand representative_hand_map;
+
+  for (int hand_size = max_hand_size - 1; hand_size >= 0; hand_size--) {
+    printf("  Processing hands of size: %d...", hand_size);
+    build_hands_of_size(hand_size, max_hand_size, max_hand_size, eval_fn, &card_suits, num_threads,
+                        &representative_hand_map, &fsm);
+  }
+
+  return fsm;
+}
+
+template <uint8_t max_hand_size>
+FSM build_unified_fsm(EvalFn eval_fn, uint8_t min_scored_size, size_t num_threads) {
+  num_threads = details::resolve_num_threads(num_threads);
+  FSM fsm;
+  ToRepresentativeHand representative_hand_map;
+
+  for (int hand_size = max_hand_size - 1; hand_size >= 0; hand_size--) {
+    printf("  Processing hands of size: %d...", hand_size);
+    build_hands_of_size(hand_size, max_hand_size, min_scored_size, eval_fn, nullptr, num_threads,
+                        &representative_hand_map, &fsm);
+  }
+
+  return fsm;
+}
+
+inline std::vector<uint16_t> build_suit_relabel_table(const CardSuits& card_suits) {
+  // Enumerate the ordered sequences of distinct suits, shortest first, so
+  // that the empty sequence is state 0.
+  std::vector<std::vector<uint8_t>> perm_states = {{}};
+  std::map<std::vector<uint8_t>, uint16_t> perm_state_idx = {{{}, 0}};
+  for (size_t i = 0; i < perm_states.size(); i++) {
+    for (uint8_t suit = 0; suit < 4; suit++) {
+      auto next = perm_states[i];
+      if (std::find(next.begin(), next.end(), suit) != next.end()) {
+        continue;
+      }
+      next.push_back(suit);
+      if (perm_state_idx.emplace(next, perm_states.size()).second) {
+        perm_states.push_back(next);
+      }
+    }
+  }
+  assert(perm_states.size() == kNumSuitPermStates);
+
+  std::vector<uint16_t> relabel(kNumSuitPermStates * 52);
+  for (uint16_t state = 0; state < kNumSuitPermStates; state++) {
+    for (Card card = 0; card < 52; card++) {
+      auto seen = perm_states[state];
+      uint8_t suit = card_suits.suit[card];
+      auto it = std::find(seen.begin(), seen.end(), suit);
+      uint8_t label = it - seen.begin();
+      if (it == seen.end()) {
+        seen.push_back(suit);
+      }
+      Card canonical_card = card_suits.with_suit[card][label];
+      relabel[state * 52 + card] = (perm_state_idx.at(seen) << 6) | canonical_card;
+    }
+  }
+  return relabel;
+}
+
 }  // namespace poker_eval
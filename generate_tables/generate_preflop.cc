@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "poker_hand_eval.h"
+#include "preflop_equity.h"
+
+namespace {
+
+using Combo = std::array<uint8_t, 2>;
+
+// All 1326 two-card combos, indexed by preflop_combo.
+std::vector<Combo> all_combos() {
+  std::vector<Combo> combos(1326);
+  for (uint8_t high = 1; high < 52; high++) {
+    for (uint8_t low = 0; low < high; low++) {
+      combos[preflop_combo(high, low)] = {high, low};
+    }
+  }
+  return combos;
+}
+
+// All 24 permutations of the four suits.
+std::vector<std::array<uint8_t, 4>> suit_permutations() {
+  std::vector<std::array<uint8_t, 4>> perms;
+  std::array<uint8_t, 4> perm = {0, 1, 2, 3};
+  do {
+    perms.push_back(perm);
+  } while (std::next_permutation(perm.begin(), perm.end()));
+  return perms;
+}
+
+// A matchup packs two combos, each with its higher card first, into 24 bits.
+uint32_t encode_matchup(const Combo& a, const Combo& b) {
+  return (uint32_t{a[0]} << 18) | (uint32_t{a[1]} << 12) | (uint32_t{b[0]} << 6) | b[1];
+}
+
+std::array<Combo, 2> decode_matchup(uint32_t key) {
+  return {{{static_cast<uint8_t>(key >> 18), static_cast<uint8_t>((key >> 12) & 63)},
+           {static_cast<uint8_t>((key >> 6) & 63), static_cast<uint8_t>(key & 63)}}};
+}
+
+struct CanonicalMatchup {
+  uint32_t key;
+  // Whether the canonical form lists the two hands in the opposite order.
+  bool swapped;
+};
+
+// Maps a matchup to the smallest encoding among all of its suit relabelings
+// and both hand orders. Poker hand values do not depend on suit names, so all
+// matchups with the same canonical key have the same equity, and swapping the
+// hands turns an equity e into 1 - e.
+CanonicalMatchup canonicalize(const Combo& a,
+                              const Combo& b,
+                              const std::vector<std::array<uint8_t, 4>>& perms) {
+  auto relabel = [](const Combo& combo, const std::array<uint8_t, 4>& perm) {
+    uint8_t c0 = combo[0] / 4 * 4 + perm[combo[0] % 4];
+    uint8_t c1 = combo[1] / 4 * 4 + perm[combo[1] % 4];
+    return Combo{std::max(c0, c1), std::min(c0, c1)};
+  };
+
+  CanonicalMatchup best = {UINT32_MAX, false};
+  for (const auto& perm : perms) {
+    Combo ra = relabel(a, perm);
+    Combo rb = relabel(b, perm);
+    uint32_t key = encode_matchup(ra, rb);
+    if (key < best.key) {
+      best = {key, false};
+    }
+    key = encode_matchup(rb, ra);
+    if (key < best.key) {
+      best = {key, true};
+    }
+  }
+  return best;
+}
+
+void save_matrix(const std::vector<float>& matrix, uint32_t num_hands, const std::string& path) {
+  PreflopEquityHeader header;
+  std::memcpy(header.magic, PreflopEquityHeader::kMagic, sizeof(header.magic));
+  header.version = PreflopEquityHeader::kVersion;
+  header.num_hands = num_hands;
+
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(matrix.data()), matrix.size() * sizeof(float));
+  file.close();
+}
+
+}  // namespace
+
+// Generates the heads-up preflop equity matrix for the 169 canonical starting
+// hands, and optionally for all 1326 concrete combos.
+//
+// Usage: generate_preflop [--full] [--threads N] [--table tables/bfs7.phe]
+//
+// Each distinct matchup, up to suit relabeling and hand order, is enumerated
+// exactly once, and the distinct matchups are spread across all cores.
+int main(int argc, char** argv) {
+  bool full = false;
+  size_t num_threads = 0;
+  std::string table_path = "tables/bfs7.phe";
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--full") {
+      full = true;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      num_threads = std::stoul(argv[++i]);
+    } else if (arg == "--table" && i + 1 < argc) {
+      table_path = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--full] [--threads N] [--table path]\n", argv[0]);
+      return 1;
+    }
+  }
+  num_threads = details::resolve_num_threads(num_threads);
+
+  PokerHandEval<7> phe(table_path);
+  const auto combos = all_combos();
+  const auto perms = suit_permutations();
+
+  printf("Finding distinct matchups...");
+  std::unordered_map<uint32_t, uint32_t> key_to_slot;
+  std::vector<uint32_t> keys;
+  std::vector<CanonicalMatchup> canonical(1326 * 1326);
+  for (uint32_t i = 0; i < 1326; i++) {
+    for (uint32_t j = 0; j < 1326; j++) {
+      const Combo& a = combos[i];
+      const Combo& b = combos[j];
+      if (a[0] == b[0] || a[0] == b[1] || a[1] == b[0] || a[1] == b[1]) {
+        continue;
+      }
+      canonical[i * 1326 + j] = canonicalize(a, b, perms);
+      if (key_to_slot.emplace(canonical[i * 1326 + j].key, keys.size()).second) {
+        keys.push_back(canonical[i * 1326 + j].key);
+      }
+    }
+  }
+  printf("  found %zu.\n", keys.size());
+
+  printf("Enumerating boards on %zu threads...", num_threads);
+  auto start_time = std::chrono::system_clock::now();
+  std::vector<float> key_equity(keys.size());
+  details::run_work_stealing(keys.size(), num_threads, [&](size_t, size_t slot) {
+    auto hands = decode_matchup(keys[slot]);
+    std::vector<Combo> holes(hands.begin(), hands.end());
+    key_equity[slot] = phe.equity(holes, std::array<uint8_t, 0>{}, std::array<uint8_t, 0>{}).equity[0];
+  });
+  auto end_time = std::chrono::system_clock::now();
+  printf("  Done in %lld ms.\n",
+         static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()));
+
+  // Expand the distinct matchups into the combo and canonical-hand matrices.
+  std::vector<float> combo_matrix(1326 * 1326, std::nanf(""));
+  std::vector<double> hand_sum(169 * 169);
+  std::vector<uint32_t> hand_count(169 * 169);
+  for (uint32_t i = 0; i < 1326; i++) {
+    for (uint32_t j = 0; j < 1326; j++) {
+      const Combo& a = combos[i];
+      const Combo& b = combos[j];
+      if (a[0] == b[0] || a[0] == b[1] || a[1] == b[0] || a[1] == b[1]) {
+        continue;
+      }
+      const CanonicalMatchup& matchup = canonical[i * 1326 + j];
+      float eq = key_equity[key_to_slot.at(matchup.key)];
+      if (matchup.swapped) {
+        eq = 1 - eq;
+      }
+      combo_matrix[i * 1326 + j] = eq;
+
+      uint32_t cell = canonical_preflop_hand(a[0], a[1]) * 169 + canonical_preflop_hand(b[0], b[1]);
+      hand_sum[cell] += eq;
+      hand_count[cell]++;
+    }
+  }
+
+  std::vector<float> hand_matrix(169 * 169);
+  for (size_t cell = 0; cell < hand_matrix.size(); cell++) {
+    hand_matrix[cell] = hand_sum[cell] / hand_count[cell];
+  }
+
+  printf("Saving tables/preflop169.eq...");
+  save_matrix(hand_matrix, 169, "tables/preflop169.eq");
+  printf("  Done.\n");
+
+  if (full) {
+    printf("Saving tables/preflop1326.eq...");
+    save_matrix(combo_matrix, 1326, "tables/preflop1326.eq");
+    printf("  Done.\n");
+  }
+}
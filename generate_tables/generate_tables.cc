@@ -1,9 +1,14 @@
+#include <algorithm>
 #include <array>
+#include <cstdio>
+#include <map>
 #include <numeric>
+#include <string>
 #include <vector>
 
 #include "generate_tables/memory_layout.h"
 #include "generate_tables/phe.h"
+#include "poker_hand_eval.h"
 #include "third_party/senzee/poker.h"
 
 using namespace poker_eval;
@@ -39,6 +44,25 @@ IdMap rank_major_map() {
   return m;
 }
 
+// Ranks and suits of the phe card ids, as given by their cactus_kev
+// counterparts.
+CardSuits card_suits(const IdMap& id_map) {
+  MapCardTo<Card> ck_to_phe{};
+  for (Card phe_id = 0; phe_id < 52; phe_id++) {
+    ck_to_phe[id_map[phe_id]] = phe_id;
+  }
+
+  CardSuits suits{};
+  for (Card phe_id = 0; phe_id < 52; phe_id++) {
+    const Card ck_id = id_map[phe_id];
+    suits.suit[phe_id] = ck_id / 13;
+    for (uint8_t suit = 0; suit < 4; suit++) {
+      suits.with_suit[phe_id][suit] = ck_to_phe[suit * 13 + ck_id % 13];
+    }
+  }
+  return suits;
+}
+
 Score eval5_with_map(const Hand& hand, const IdMap& id_map) {
   const std::vector<int>& ck_deck = deck();
   int ck_hand[5] = {ck_deck[id_map[hand.cards[0]]],
@@ -50,7 +74,7 @@ Score eval5_with_map(const Hand& hand, const IdMap& id_map) {
 }
 
 Score eval7_with_map(const Hand& hand, const IdMap& id_map) {
-  const std::vector<int> ck_deck = deck();
+  const std::vector<int>& ck_deck = deck();
   int ck_hand[7] = {ck_deck[id_map[hand.cards[0]]],
                     ck_deck[id_map[hand.cards[1]]],
                     ck_deck[id_map[hand.cards[2]]],
@@ -61,6 +85,28 @@ Score eval7_with_map(const Hand& hand, const IdMap& id_map) {
   return eval_7hand(ck_hand);
 }
 
+// Best five-card score of a hand of 5 to 7 cards.
+Score eval_any_with_map(const Hand& hand, const IdMap& id_map) {
+  if (hand.size == 5) {
+    return eval5_with_map(hand, id_map);
+  }
+  if (hand.size == 7) {
+    return eval7_with_map(hand, id_map);
+  }
+  Score best = UINT32_MAX;
+  for (uint8_t skip = 0; skip < hand.size; skip++) {
+    Hand sub;
+    sub.size = 5;
+    for (uint8_t i = 0; i < hand.size; i++) {
+      if (i != skip) {
+        sub.cards[i - (i > skip)] = hand.cards[i];
+      }
+    }
+    best = std::min(best, eval5_with_map(sub, id_map));
+  }
+  return best;
+}
+
 }  // namespace cactus_kev
 
 // Generates tables for 5 and 7-card poker hands, using various layout schemes.
@@ -79,16 +125,98 @@ Score eval7_with_map(const Hand& hand, const IdMap& id_map) {
 // You may choose a different mapping by switching out the eval to one of your
 // choice.
 // Note that the cards values must be in the range [0, 52).
-int main() {
+//
+// Usage: generate_tables [--threads N] [--profile path.hist]...
+//
+// The tables do not depend on the number of threads.
+//
+// tables/aligned*.phe, tables/page*.phe and tables/hugepage*.phe pad rows to
+// 64 slots, so that each row is four whole cache lines. aligned keeps the
+// bfs order; page and hugepage cluster parents and children into 4 KiB and
+// 2 MiB pages, for use with and without huge pages.
+//
+// Each --profile histogram, recorded with PokerHandEval::eval_recorded on
+// tables/bfs5.phe or tables/bfs7.phe, adds a profile-guided layout,
+// tables/pgo5.phe or tables/pgo7.phe.
+int main(int argc, char** argv) {
+  size_t num_threads = 0;
+  std::map<uint32_t, RowHistogram> profiles;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      num_threads = std::stoul(argv[++i]);
+    } else if (arg == "--profile" && i + 1 < argc) {
+      RowHistogram histogram(argv[++i]);
+      profiles.emplace(histogram.hand_size(), std::move(histogram));
+    } else {
+      fprintf(stderr, "Usage: %s [--threads N] [--profile path.hist]...\n", argv[0]);
+      return 1;
+    }
+  }
+
   const cactus_kev::IdMap id_map = cactus_kev::rank_major_map();
 
-  build_phes<5>([&id_map](const Hand& hand) { return cactus_kev::eval5_with_map(hand, id_map); }, {
-                                    {"tables/bfs5.phe", bfs_memory_order<5>},
-                                    {"tables/dfs5.phe", dfs_memory_order<5>},
-                                    {"tables/veb5.phe", veb_memory_order<5>}});
+  RowPlacement aligned_rows;
+  aligned_rows.row_stride = 64;
+  RowPlacement page_rows = aligned_rows;
+  page_rows.page_bytes = 4096;
+  RowPlacement hugepage_rows = aligned_rows;
+  hugepage_rows.page_bytes = 2 << 20;
+
+  std::map<std::string, MemoryLayoutFn<5>> layouts5 = {
+      {"tables/bfs5.phe", bfs_memory_order<5>},
+      {"tables/dfs5.phe", dfs_memory_order<5>},
+      {"tables/veb5.phe", veb_memory_order<5>},
+      {"tables/aligned5.phe", bfs_memory_order<5>},
+      {"tables/page5.phe", [&page_rows](const FSM& fsm) {
+         return page_clustered_memory_order<5>(fsm, page_rows.rows_per_page());
+       }},
+      {"tables/hugepage5.phe", [&hugepage_rows](const FSM& fsm) {
+         return page_clustered_memory_order<5>(fsm, hugepage_rows.rows_per_page());
+       }}};
+  std::map<std::string, RowPlacement> placements5 = {
+      {"tables/aligned5.phe", aligned_rows},
+      {"tables/page5.phe", page_rows},
+      {"tables/hugepage5.phe", hugepage_rows}};
+  if (profiles.count(5)) {
+    layouts5["tables/pgo5.phe"] = [counts = profiles.at(5).counts()](const FSM& fsm) {
+      return profile_guided_memory_order<5>(fsm, counts, bfs_memory_order<5>);
+    };
+  }
+  build_phes<5>([&id_map](const Hand& hand) { return cactus_kev::eval5_with_map(hand, id_map); }, layouts5, {
+                                    {"tables/bfs5.phe16", bfs_memory_order<5>}}, num_threads, placements5);
+
+  std::map<std::string, MemoryLayoutFn<7>> layouts7 = {
+      {"tables/bfs7.phe", bfs_memory_order<7>},
+      {"tables/dfs7.phe", dfs_memory_order<7>},
+      {"tables/veb7.phe", veb_memory_order<7>},
+      {"tables/aligned7.phe", bfs_memory_order<7>},
+      {"tables/page7.phe", [&page_rows](const FSM& fsm) {
+         return page_clustered_memory_order<7>(fsm, page_rows.rows_per_page());
+       }},
+      {"tables/hugepage7.phe", [&hugepage_rows](const FSM& fsm) {
+         return page_clustered_memory_order<7>(fsm, hugepage_rows.rows_per_page());
+       }}};
+  std::map<std::string, RowPlacement> placements7 = {
+      {"tables/aligned7.phe", aligned_rows},
+      {"tables/page7.phe", page_rows},
+      {"tables/hugepage7.phe", hugepage_rows}};
+  if (profiles.count(7)) {
+    layouts7["tables/pgo7.phe"] = [counts = profiles.at(7).counts()](const FSM& fsm) {
+      return profile_guided_memory_order<7>(fsm, counts, bfs_memory_order<7>);
+    };
+  }
+  build_phes<7>([&id_map](const Hand& hand) { return cactus_kev::eval7_with_map(hand, id_map); }, layouts7, {
+                                    {"tables/bfs7.phe16", bfs_memory_order<7>}}, num_threads, placements7);
+
+  build_unified_phes<5, 7>([&id_map](const Hand& hand) { return cactus_kev::eval_any_with_map(hand, id_map); }, {
+                                    {"tables/unified7.phe", bfs_memory_order<7>}}, num_threads);
+
+  const CardSuits card_suits = cactus_kev::card_suits(id_map);
+
+  build_suit_canonical_phes<5>([&id_map](const Hand& hand) { return cactus_kev::eval5_with_map(hand, id_map); }, card_suits, {
+                                    {"tables/canon5.phe", bfs_memory_order<5>}}, num_threads);
 
-  build_phes<7>([&id_map](const Hand& hand) { return cactus_kev::eval7_with_map(hand, id_map); }, {
-                                    {"tables/bfs7.phe", bfs_memory_order<7>},
-                                    {"tables/dfs7.phe", dfs_memory_order<7>},
-                                    {"tables/veb7.phe", veb_memory_order<7>}});
+  build_suit_canonical_phes<7>([&id_map](const Hand& hand) { return cactus_kev::eval7_with_map(hand, id_map); }, card_suits, {
+                                    {"tables/canon7.phe", bfs_memory_order<7>}}, num_threads);
 }
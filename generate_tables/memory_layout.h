@@ -24,11 +24,84 @@ std::vector<EncodedHand> dfs_memory_order(const FSM& fsm);
 template <uint8_t hand_size>
 std::vector<EncodedHand> veb_memory_order(const FSM& fsm);
 
+// Lay's out the states by decreasing visit count, so that the rows a real
+// workload touches are packed into the fewest cache lines and pages, and cold
+// rows go at the end.
+// row_counts[r] is the number of visits of row r of a table flattened with
+// base_layout, e.g. as recorded by RowHistogram. Ties, including all
+// unvisited states, keep their base order. The root always comes first.
+template <uint8_t hand_size>
+std::vector<EncodedHand> profile_guided_memory_order(const FSM& fsm,
+                                                     const std::vector<uint64_t>& row_counts,
+                                                     const MemoryLayoutFn<hand_size>& base_layout);
+
+// Where flatten_fsm puts each row. The default packs 52-slot rows back to
+// back, so a 208-byte row spans four or five cache lines depending on its
+// offset, and now and then two pages.
+//
+// Stored entries are absolute slot offsets, so the evaluators walk a padded
+// table unchanged. Padding slots hold 0. Whatever counts rows as
+// offset / 52 (num_rows, eval_recorded, CountingInstrumentation,
+// phe_compress) only understands the default placement.
+struct RowPlacement {
+  // Slots per row, at least 52. 64 makes a row 256 bytes: four whole cache
+  // lines, and never across a page.
+  uint32_t row_stride = 52;
+  // If nonzero, rows are packed page_bytes at a time, and the tail of a page
+  // that cannot hold another row is padding, so that no row straddles a page.
+  uint32_t page_bytes = 0;
+
+  uint32_t rows_per_page() const;
+  // Offset of the first slot of row `row`.
+  uint32_t offset(uint32_t row) const;
+};
+
+// Lay's out the states so that each page of rows_per_page rows holds a
+// connected piece of the FSM: a state, then its descendants breadth-first
+// until the page is full. Descendants that do not fit start later pages,
+// taken in breadth-first order, and pages left short by a small subtree are
+// topped up with the next ones. A walk then crosses fewer pages, and so
+// misses the TLB less, than with bfs_memory_order, where a row's children
+// are spread over many pages of its level.
+// Pair it with the RowPlacement whose pages it fills, e.g. 16 rows for
+// 4 KiB pages of 64-slot rows, or 8192 for 2 MiB pages.
+template <uint8_t hand_size>
+std::vector<EncodedHand> page_clustered_memory_order(const FSM& fsm, uint32_t rows_per_page);
+
 // Flattens a finite-state-machine, given the ordering of states.
 // Use the above functions to create a state-ordering.
 template <uint8_t hand_size>
 std::vector<uint32_t> flatten_fsm(const FSM& fsm,
-                                  const std::vector<EncodedHand>& order);
+                                  const std::vector<EncodedHand>& order,
+                                  const RowPlacement& placement = RowPlacement());
+
+// A flattened finite-state-machine with the terminal rows split off and
+// narrowed to 16 bits. See compact_hand_eval.h.
+struct CompactTable {
+  // Rows of the first hand_size - 1 levels. Entries of the last of these
+  // levels are offsets into terminal.
+  std::vector<uint32_t> interior;
+  // Rows of scores.
+  std::vector<uint16_t> terminal;
+};
+
+// As flatten_fsm, but produces a CompactTable. Interior and terminal rows
+// each keep their relative position in the given ordering.
+template <uint8_t hand_size>
+CompactTable flatten_fsm_compact(const FSM& fsm,
+                                 const std::vector<EncodedHand>& order);
+
+// Number of slots in a row of a unified table: one per card, then the score
+// of the hand so far. See unified_hand_eval.h.
+constexpr uint32_t kUnifiedRowSize = 53;
+
+// As flatten_fsm, for FSMs built by build_unified_fsm. Rows hold
+// kUnifiedRowSize slots, and row offsets are multiples of kUnifiedRowSize.
+// The last slot of each row holds the state's score, or 0 for hands too
+// small to be scored.
+template <uint8_t hand_size>
+std::vector<uint32_t> flatten_fsm_unified(const FSM& fsm,
+                                          const std::vector<EncodedHand>& order);
 
 }  // namespace poker_eval
 
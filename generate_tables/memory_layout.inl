@@ -1,6 +1,10 @@
 #include <cassert>
+#include <numeric>
 #include <queue>
 #include <stack>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace poker_eval {
 
@@ -23,7 +27,7 @@ std::vector<EncodedHand> dfs_memory_order(const FSM& fsm) {
     auto child = pc.second;
     dfs.pop();
 
-    if (!has_key(fsm, child) || has_key(depth, child) || depth[parent] >= hand_size) {
+    if (!fsm.contains(child) || has_key(depth, child) || depth[parent] >= hand_size) {
       continue;
     }
     order.push_back(child);
@@ -49,7 +53,7 @@ std::vector<EncodedHand> bfs_memory_order(const FSM& fsm) {
     HandOrScore hand = bfs.front();
     bfs.pop();
 
-    if (!has_key(fsm, hand) || has_key(seen_hands, hand)) {
+    if (!fsm.contains(hand) || has_key(seen_hands, hand)) {
       continue;
     }
     order.push_back(hand);
@@ -115,22 +119,110 @@ std::vector<EncodedHand> veb_memory_order(const FSM& fsm) {
   return veb_memory_order_helper<hand_size>(fsm, 0, seen_hands).first;
 }
 
+template <uint8_t hand_size>
+std::vector<EncodedHand> profile_guided_memory_order(const FSM& fsm,
+                                                     const std::vector<uint64_t>& row_counts,
+                                                     const MemoryLayoutFn<hand_size>& base_layout) {
+  std::vector<EncodedHand> order = base_layout(fsm);
+  if (row_counts.size() != order.size()) {
+    throw std::invalid_argument("profile_guided_memory_order: histogram does not match the base layout");
+  }
+
+  // The root is the first row of every layout; keep it there.
+  std::vector<uint32_t> rows(order.size() - 1);
+  std::iota(rows.begin(), rows.end(), 1);
+  std::stable_sort(rows.begin(), rows.end(), [&](uint32_t a, uint32_t b) {
+    return row_counts[a] > row_counts[b];
+  });
+
+  std::vector<EncodedHand> guided_order = {order[0]};
+  for (uint32_t row : rows) {
+    guided_order.push_back(order[row]);
+  }
+  return guided_order;
+}
+
+template <uint8_t hand_size>
+std::vector<EncodedHand> page_clustered_memory_order(const FSM& fsm, uint32_t rows_per_page) {
+  if (rows_per_page == 0) {
+    throw std::invalid_argument("page_clustered_memory_order: rows_per_page must be positive");
+  }
+
+  std::unordered_set<EncodedHand> seen_hands;
+  std::vector<EncodedHand> order;
+
+  // States whose parent's page was full; each may start a page.
+  std::queue<EncodedHand> roots;
+  roots.push(0);
+
+  while (!roots.empty()) {
+    std::queue<EncodedHand> page;
+    for (uint32_t num_rows = 0; num_rows < rows_per_page;) {
+      if (page.empty()) {
+        if (roots.empty()) {
+          break;
+        }
+        page.push(roots.front());
+        roots.pop();
+      }
+      EncodedHand hand = page.front();
+      page.pop();
+      if (has_key(seen_hands, hand)) {
+        continue;
+      }
+      order.push_back(hand);
+      seen_hands.insert(hand);
+      num_rows++;
+
+      // The last level holds scores, not states.
+      if (Hand::decode(hand).size + 1u == hand_size) {
+        continue;
+      }
+      for (Card card = 0; card < 52; card++) {
+        HandOrScore next_hand = fsm.at(hand)[card];
+        if (fsm.contains(next_hand) && !has_key(seen_hands, next_hand)) {
+          page.push(next_hand);
+        }
+      }
+    }
+    for (; !page.empty(); page.pop()) {
+      roots.push(page.front());
+    }
+  }
+
+  return order;
+}
+
+inline uint32_t RowPlacement::rows_per_page() const {
+  return page_bytes == 0 ? UINT32_MAX : page_bytes / (row_stride * sizeof(uint32_t));
+}
+
+inline uint32_t RowPlacement::offset(uint32_t row) const {
+  if (page_bytes == 0) {
+    return row * row_stride;
+  }
+  uint32_t page_slots = page_bytes / sizeof(uint32_t);
+  return row / rows_per_page() * page_slots + row % rows_per_page() * row_stride;
+}
+
 template <uint8_t max_hand_size>
 std::vector<uint32_t> flatten_fsm(const FSM& fsm,
-                                  const std::vector<EncodedHand>& order) {
+                                  const std::vector<EncodedHand>& order,
+                                  const RowPlacement& placement) {
   assert(fsm.size() == order.size());
   assert(order[0] == 0);
+  if (placement.row_stride < 52 || placement.rows_per_page() == 0) {
+    throw std::invalid_argument("flatten_fsm: rows must hold 52 slots and fit in a page");
+  }
 
-  std::unordered_map<uint32_t, EncodedHand> idx_to_hand;
   std::unordered_map<EncodedHand, uint32_t> hand_to_idx;
-  uint32_t next_idx = 0;
+  uint32_t num_rows = 0;
   for (EncodedHand hand : order) {
-    idx_to_hand[next_idx] = hand;
-    hand_to_idx[hand] = next_idx;
-    next_idx += 52;
+    hand_to_idx[hand] = placement.offset(num_rows++);
   }
 
-  std::vector<uint32_t> memory(next_idx);
+  // Ends with the last row's 52 slots, not its padding.
+  std::vector<uint32_t> memory(placement.offset(num_rows - 1) + 52);
 
   for (auto&& pair : hand_to_idx) {
     EncodedHand hand = pair.first;
@@ -152,4 +244,82 @@ std::vector<uint32_t> flatten_fsm(const FSM& fsm,
   return memory;
 }
 
+template <uint8_t max_hand_size>
+std::vector<uint32_t> flatten_fsm_unified(const FSM& fsm,
+                                          const std::vector<EncodedHand>& order) {
+  assert(fsm.size() == order.size());
+  assert(order[0] == 0);
+
+  std::unordered_map<EncodedHand, uint32_t> hand_to_idx;
+  uint32_t next_idx = 0;
+  for (EncodedHand hand : order) {
+    hand_to_idx[hand] = next_idx;
+    next_idx += kUnifiedRowSize;
+  }
+
+  std::vector<uint32_t> memory(next_idx);
+
+  for (auto&& pair : hand_to_idx) {
+    EncodedHand hand = pair.first;
+    uint32_t idx = pair.second;
+
+    if (Hand::decode(hand).size + 1u == max_hand_size) {
+      for (Card card = 0; card < 52; card++) {
+        memory[idx + card] = fsm.at(hand)[card];
+      }
+    } else {
+      for (Card card = 0; card < 52; card++) {
+        memory[idx + card] = hand_to_idx[fsm.at(hand)[card]];
+      }
+    }
+    memory[idx + 52] = fsm.score(hand);
+  }
+
+  return memory;
+}
+
+template <uint8_t max_hand_size>
+CompactTable flatten_fsm_compact(const FSM& fsm,
+                                 const std::vector<EncodedHand>& order) {
+  assert(fsm.size() == order.size());
+  assert(order[0] == 0);
+
+  auto is_terminal = [](EncodedHand hand) {
+    return Hand::decode(hand).size + 1u == max_hand_size;
+  };
+
+  std::unordered_map<EncodedHand, uint32_t> hand_to_idx;
+  uint32_t next_interior_idx = 0;
+  uint32_t next_terminal_idx = 0;
+  for (EncodedHand hand : order) {
+    uint32_t& next_idx = is_terminal(hand) ? next_terminal_idx : next_interior_idx;
+    hand_to_idx[hand] = next_idx;
+    next_idx += 52;
+  }
+
+  CompactTable table;
+  table.interior.resize(next_interior_idx);
+  table.terminal.resize(next_terminal_idx);
+
+  for (auto&& pair : hand_to_idx) {
+    EncodedHand hand = pair.first;
+    uint32_t idx = pair.second;
+
+    if (is_terminal(hand)) {
+      for (Card card = 0; card < 52; card++) {
+        Score score = fsm.at(hand)[card];
+        assert(score <= UINT16_MAX);
+        table.terminal[idx + card] = score;
+      }
+    } else {
+      for (Card card = 0; card < 52; card++) {
+        EncodedHand next_hand = fsm.at(hand)[card];
+        table.interior[idx + card] = hand_to_idx[next_hand];
+      }
+    }
+  }
+
+  return table;
+}
+
 }  // namespace poker_eval
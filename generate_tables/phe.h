@@ -12,10 +12,38 @@ namespace poker_eval {
 // contain a lookup table that produce evaluations matching the evaluations
 // produced by the eval_fn provided here.
 // layout_files is a mapping from filename to state-layout-order.
+// compact_layout_files is the same, for tables in the 16-bit compact format
+// used by compact_hand_eval.h.
+// The FSM is built on num_threads threads (0 means one per hardware thread);
+// the files do not depend on it.
+// row_placements gives the RowPlacement of any of layout_files that should
+// not use 52-slot rows packed back to back.
 template <uint8_t hand_size>
 void build_phes(
     EvalFn eval_fn,
-    const std::map<std::string, MemoryLayoutFn<hand_size>>& layout_files);
+    const std::map<std::string, MemoryLayoutFn<hand_size>>& layout_files,
+    const std::map<std::string, MemoryLayoutFn<hand_size>>& compact_layout_files = {},
+    size_t num_threads = 0,
+    const std::map<std::string, RowPlacement>& row_placements = {});
+
+// As build_phes, but the tables only hold suit-canonical hands, and are
+// prefixed with the suit relabeling side channel.
+// See suit_canonical_hand_eval.h.
+template <uint8_t hand_size>
+void build_suit_canonical_phes(
+    EvalFn eval_fn,
+    const CardSuits& card_suits,
+    const std::map<std::string, MemoryLayoutFn<hand_size>>& layout_files,
+    size_t num_threads = 0);
+
+// As build_phes, but the tables are unified tables, which also score hands
+// of min_hand_size to max_hand_size - 1 cards. eval_fn must accept hands of
+// all of those sizes. See unified_hand_eval.h.
+template <uint8_t min_hand_size, uint8_t max_hand_size>
+void build_unified_phes(
+    EvalFn eval_fn,
+    const std::map<std::string, MemoryLayoutFn<max_hand_size>>& layout_files,
+    size_t num_threads = 0);
 
 }  // namespace poker_eval
 
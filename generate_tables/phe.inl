@@ -1,55 +1,21 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
+#include "compact_hand_eval.h"
 #include "poker_hand_eval.h"
+#include "suit_canonical_hand_eval.h"
+#include "unified_hand_eval.h"
 
 namespace poker_eval {
 namespace {
 
-template <uint8_t hand_size>
-bool validate_fsm(const FSM& fsm, EvalFn eval_fn) {
-  bool all_good = true;
-
-  for_each_hand(hand_size, [&](const Hand& hand) {
-    HandOrScore expected = eval_fn(hand);
-
-    HandOrScore actual = 0;
-    for (uint8_t i = 0; i < hand_size; i++) {
-      actual = fsm.at(actual)[hand.cards[i]];
-    }
-
-    if (expected != actual) {
-      printf("Mismatch for %s!\n  expected=%llu\n  actual=%llu\n",
-             hand.debug_string().c_str(),
-             static_cast<unsigned long long>(expected),
-             static_cast<unsigned long long>(actual));
-      all_good = false;
-    }
-  });
-
-  return all_good;
-}
-
-template <uint8_t hand_size>
-bool validate_phe(const PokerHandEval<hand_size>& phe, EvalFn eval_fn) {
-  bool all_good = true;
-
-  for_each_hand(hand_size, [&](const Hand& hand) {
-    Score expected = eval_fn(hand);
-    Score actual = phe.eval(hand.cards);
-
-    if (expected != actual) {
-      printf("Mismatch for %s!\n  expected=%u\n  actual=%u\n",
-             hand.debug_string().c_str(), expected, actual);
-      all_good = false;
-    }
-  });
-
-  return all_good;
-}
-
 template <typename T>
 std::string human_readable_duration(const T& duration) {
   auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration);
@@ -102,6 +68,255 @@ std::string human_readable_filesize(size_t num_bytes) {
   return ss.str();
 }
 
+// Enumerates every hand of hand_size cards, in increasing card order, on
+// num_threads threads. The hands are split into one task per smallest card,
+// largest task first. Each task gets its own visitor from make_visitor(), on
+// which it calls:
+//   extend(depth, card), as the prefix of `depth` cards grows by `card`, for
+//     every prefix of fewer than hand_size - 1 cards;
+//   visit(hand, rank), for every hand, with its colex_rank.
+template <uint8_t hand_size, typename MakeVisitor>
+void parallel_for_each_hand(size_t num_threads, MakeVisitor make_visitor) {
+  static_assert(hand_size >= 1 && hand_size <= 7, "Hands hold 1 to 7 cards.");
+
+  auto descend = [](auto& self, auto& visitor, Hand* hand, uint8_t depth, uint32_t rank) -> void {
+    if (depth == hand_size) {
+      visitor.visit(*hand, rank);
+      return;
+    }
+    for (Card card = hand->cards[depth - 1] + 1; card + hand_size - depth <= 52; card++) {
+      if (depth + 1 < hand_size) {
+        visitor.extend(depth, card);
+      }
+      hand->cards[depth] = card;
+      self(self, visitor, hand, depth + 1, rank + kChoose[card][depth + 1]);
+    }
+  };
+
+  details::run_work_stealing(52 - hand_size + 1, details::resolve_num_threads(num_threads), [&](size_t, size_t task) {
+    auto visitor = make_visitor();
+    Hand hand;
+    hand.size = hand_size;
+    hand.cards[0] = task;
+    if (hand_size > 1) {
+      visitor.extend(0, hand.cards[0]);
+    }
+    descend(descend, visitor, &hand, 1, kChoose[hand.cards[0]][1]);
+  });
+}
+
+// The bootstrap score of every hand of hand_size cards, by colex_rank.
+// eval_fn runs once per hand here, and every validation of the FSM and of
+// the saved tables reads its scores from the result.
+template <uint8_t hand_size>
+std::vector<Score> bootstrap_scores(EvalFn eval_fn, size_t num_threads) {
+  struct Visitor {
+    const EvalFn* eval_fn;
+    Score* scores;
+
+    void extend(uint8_t, Card) {}
+    void visit(const Hand& hand, uint32_t rank) { scores[rank] = (*eval_fn)(hand); }
+  };
+
+  std::vector<Score> scores(num_hands_of_size(hand_size));
+  parallel_for_each_hand<hand_size>(num_threads, [&] { return Visitor{&eval_fn, scores.data()}; });
+  return scores;
+}
+
+// Walkers follow hands through one table, a card at a time:
+//   State root() const;
+//   State step(State state, Card card) const;  // every card but the last
+//   HandOrScore score(State state, Card card) const;  // the last card
+// The sweep steps each prefix once, and shares it with every hand that
+// extends it.
+
+// Walks the FSM itself. A state is the out edges of a prefix, so each hand
+// costs one lookup of its last card.
+struct FsmWalker {
+  using State = const MapCardTo<HandOrScore>*;
+
+  const FSM* fsm;
+
+  State root() const { return &fsm->at(0); }
+  State step(State state, Card card) const { return &fsm->at((*state)[card]); }
+  HandOrScore score(State state, Card card) const { return (*state)[card]; }
+};
+
+// Walks a suit-canonical FSM through the relabeling side channel.
+struct SuitCanonicalFsmWalker {
+  struct State {
+    const MapCardTo<HandOrScore>* edges;
+    uint32_t perm_state;
+  };
+
+  const FSM* fsm;
+  const std::vector<uint16_t>* relabel;
+
+  State root() const { return {&fsm->at(0), 0}; }
+  State step(State state, Card card) const {
+    uint16_t relabeled = (*relabel)[state.perm_state * 52 + card];
+    return {&fsm->at((*state.edges)[relabeled & 63]), static_cast<uint32_t>(relabeled >> 6)};
+  }
+  HandOrScore score(State state, Card card) const {
+    uint16_t relabeled = (*relabel)[state.perm_state * 52 + card];
+    return (*state.edges)[relabeled & 63];
+  }
+};
+
+// Evaluates a hand sorted by the sweep, in the order that walks its smallest
+// card first: PokerHandEval walks its container from the back, the others
+// from the front. Consecutive hands of the sweep then share every row of
+// their walks but the last one.
+template <typename Phe, size_t hand_size>
+Score eval_sorted(const Phe& phe, const std::array<Card, hand_size>& cards) {
+  return phe.eval(cards);
+}
+
+template <uint8_t table_hand_size, size_t hand_size>
+Score eval_sorted(const PokerHandEval<table_hand_size>& phe, const std::array<Card, hand_size>& cards) {
+  std::array<Card, hand_size> reversed;
+  std::reverse_copy(cards.begin(), cards.end(), reversed.begin());
+  return phe.eval(reversed);
+}
+
+template <uint8_t min_hand_size, uint8_t max_hand_size, size_t hand_size>
+Score eval_sorted(const UnifiedPokerHandEval<min_hand_size, max_hand_size>& phe,
+                  const std::array<Card, hand_size>& cards) {
+  return phe.eval_n(cards, hand_size);
+}
+
+// Walks a saved table through its evaluator, as loaded from disk. Evaluators
+// have no incremental interface in common, so a state is just the prefix,
+// and the whole hand is evaluated at its last card. Any evaluator fits, so
+// that tables of every format are validated in the same sweep.
+template <uint8_t hand_size>
+struct EvaluatorWalker {
+  struct State {
+    std::array<Card, hand_size> cards;
+    uint8_t size;
+  };
+
+  const void* phe;
+  Score (*eval)(const void* phe, const std::array<Card, hand_size>& cards);
+
+  State root() const { return {{}, 0}; }
+  State step(State state, Card card) const {
+    state.cards[state.size++] = card;
+    return state;
+  }
+  HandOrScore score(State state, Card card) const {
+    state.cards[hand_size - 1] = card;
+    return eval(phe, state.cards);
+  }
+};
+
+template <uint8_t hand_size, typename Phe>
+EvaluatorWalker<hand_size> evaluator_walker(const Phe& phe) {
+  return {&phe, [](const void* p, const std::array<Card, hand_size>& cards) {
+            return eval_sorted(*static_cast<const Phe*>(p), cards);
+          }};
+}
+
+// Mismatches printed per table; the rest are only counted.
+constexpr uint64_t kMaxReportedMismatches = 10;
+
+// Sweeps every hand of hand_size cards once, through all of `walkers` at
+// the same time, on num_threads threads, and compares each score to
+// expected[colex_rank(hand)]. Mismatches are printed with the table's name,
+// the hand and its rank. Returns the number of mismatches of each walker.
+template <uint8_t hand_size, typename Walker>
+std::vector<uint64_t> validate_walkers(const std::vector<Walker>& walkers,
+                                       const std::vector<std::string>& names,
+                                       const std::vector<Score>& expected,
+                                       size_t num_threads) {
+  using State = typename Walker::State;
+  std::vector<std::atomic<uint64_t>> mismatches(walkers.size());
+  for (auto& count : mismatches) {
+    count.store(0);
+  }
+  std::mutex print_mutex;
+
+  struct Visitor {
+    const std::vector<Walker>* walkers;
+    const std::vector<std::string>* names;
+    const std::vector<Score>* expected;
+    std::vector<std::atomic<uint64_t>>* mismatches;
+    std::mutex* print_mutex;
+    // states[depth][w] is the state of walker w after `depth` cards.
+    std::vector<std::vector<State>> states;
+
+    void extend(uint8_t depth, Card card) {
+      for (size_t w = 0; w < walkers->size(); w++) {
+        states[depth + 1][w] = (*walkers)[w].step(states[depth][w], card);
+      }
+    }
+
+    void visit(const Hand& hand, uint32_t rank) {
+      const HandOrScore want = (*expected)[rank];
+      const Card last = hand.cards[hand_size - 1];
+      for (size_t w = 0; w < walkers->size(); w++) {
+        HandOrScore actual = (*walkers)[w].score(states[hand_size - 1][w], last);
+        if (actual != want && (*mismatches)[w]++ < kMaxReportedMismatches) {
+          std::lock_guard<std::mutex> lock(*print_mutex);
+          printf("\nMismatch in %s for %s (rank %u)!\n  expected=%llu\n  actual=%llu\n",
+                 (*names)[w].c_str(), hand.debug_string().c_str(), rank,
+                 static_cast<unsigned long long>(want),
+                 static_cast<unsigned long long>(actual));
+        }
+      }
+    }
+  };
+
+  parallel_for_each_hand<hand_size>(num_threads, [&] {
+    Visitor visitor{&walkers, &names, &expected, &mismatches, &print_mutex,
+                    std::vector<std::vector<State>>(hand_size, std::vector<State>(walkers.size()))};
+    for (size_t w = 0; w < walkers.size(); w++) {
+      visitor.states[0][w] = walkers[w].root();
+    }
+    return visitor;
+  });
+
+  std::vector<uint64_t> counts;
+  for (const auto& count : mismatches) {
+    counts.push_back(count.load());
+  }
+  return counts;
+}
+
+// Prints the outcome of validating each saved table, and deletes those with
+// mismatches.
+void remove_failed_tables(const std::vector<std::string>& paths, const std::vector<uint64_t>& mismatches) {
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (mismatches[i] == 0) {
+      printf("  %s: Done.\n", paths[i].c_str());
+    } else {
+      printf("  %s: Failed with %llu mismatches.\n", paths[i].c_str(),
+             static_cast<unsigned long long>(mismatches[i]));
+      std::remove(paths[i].c_str());
+    }
+  }
+}
+
+// Validates saved tables of one hand size in a single sweep.
+template <uint8_t hand_size>
+std::vector<uint64_t> validate_saved_tables(const std::vector<std::string>& paths,
+                                            const std::vector<EvaluatorWalker<hand_size>>& walkers,
+                                            const std::vector<Score>& expected,
+                                            size_t num_threads) {
+  printf("\nValidating %zu optimized evaluator(s) on hands of size %d...", paths.size(), hand_size);
+  fflush(stdout);
+  auto start_time = std::chrono::steady_clock::now();
+  auto mismatches = validate_walkers<hand_size>(walkers, paths, expected, num_threads);
+  auto duration_str = human_readable_duration(std::chrono::steady_clock::now() - start_time);
+  printf("  Done; took %s\n", duration_str.c_str());
+  return mismatches;
+}
+
+template <uint8_t hand_size, typename Walker>
+bool validate_fsm(const Walker& walker, const std::vector<Score>& expected, size_t num_threads) {
+  return validate_walkers<hand_size>(std::vector<Walker>{walker}, {"FSM"}, expected, num_threads)[0] == 0;
+}
+
 void save_lookup_table(const std::vector<uint32_t>& lookup_table,
                        const std::string& path) {
   std::ofstream file(path, std::ios::out | std::ios::binary);
@@ -110,32 +325,146 @@ void save_lookup_table(const std::vector<uint32_t>& lookup_table,
   file.close();
 }
 
+void save_suit_canonical_lookup_table(const std::vector<uint16_t>& relabel,
+                                      const std::vector<uint32_t>& lookup_table,
+                                      const std::string& path) {
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  file.write(reinterpret_cast<const char*>(&relabel[0]),
+             relabel.size() * sizeof(uint16_t));
+  file.write(reinterpret_cast<const char*>(&lookup_table[0]),
+             lookup_table.size() * sizeof(uint32_t));
+  file.close();
+}
+
+template <uint8_t hand_size>
+void save_compact_lookup_table(const CompactTable& table,
+                               const std::string& path) {
+  CompactPheHeader header;
+  std::memcpy(header.magic, CompactPheHeader::kMagic, sizeof(header.magic));
+  header.version = CompactPheHeader::kVersion;
+  header.hand_size = hand_size;
+  header.num_interior = table.interior.size();
+  header.num_terminal = table.terminal.size();
+
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(&table.interior[0]),
+             table.interior.size() * sizeof(uint32_t));
+  file.write(reinterpret_cast<const char*>(&table.terminal[0]),
+             table.terminal.size() * sizeof(uint16_t));
+  file.close();
+}
+
+void save_unified_lookup_table(const std::vector<uint32_t>& lookup_table,
+                               uint8_t min_hand_size,
+                               uint8_t max_hand_size,
+                               const std::string& path) {
+  UnifiedPheHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, UnifiedPheHeader::kMagic, sizeof(header.magic));
+  header.version = UnifiedPheHeader::kVersion;
+  header.min_hand_size = min_hand_size;
+  header.max_hand_size = max_hand_size;
+  header.num_entries = lookup_table.size();
+
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(&lookup_table[0]),
+             lookup_table.size() * sizeof(uint32_t));
+  file.close();
+}
+
 template <uint8_t hand_size>
 void save_phes(
     const FSM& fsm,
     const std::map<std::string, MemoryLayoutFn<hand_size>>& layout_files,
-    EvalFn eval_fn) {
+    const std::map<std::string, RowPlacement>& row_placements) {
   for (const auto& pair : layout_files) {
     const auto& path = pair.first;
     const auto& layout_fn = pair.second;
+    auto found = row_placements.find(path);
+    bool padded = found != row_placements.end();
 
     printf("\nProcessing memory layout for %s...\n", path.c_str());
 
     printf("  Ordering memory...");
-    auto table = flatten_fsm<hand_size>(fsm, layout_fn(fsm));
+    auto table = flatten_fsm<hand_size>(fsm, layout_fn(fsm), padded ? found->second : RowPlacement());
     printf("  Done.\n");
 
+    if (padded) {
+      auto filesize_str = human_readable_filesize(table.size() * sizeof(uint32_t));
+      printf("  Table size with padding: %s.\n", filesize_str.c_str());
+    }
+
     printf("  Saving table...");
     save_lookup_table(table, path);
     printf("  Done.\n");
+  }
+}
 
-    printf("  Validating optimized evaluator...");
-    if (validate_phe<hand_size>(PokerHandEval<hand_size>(path), eval_fn)) {
-      printf("  Done.\n");
-    } else {
-      printf("  Failed.\n");
-      std::remove(path.c_str());
-    }
+template <uint8_t hand_size>
+void save_compact_phes(
+    const FSM& fsm,
+    const std::map<std::string, MemoryLayoutFn<hand_size>>& layout_files) {
+  for (const auto& pair : layout_files) {
+    const auto& path = pair.first;
+    const auto& layout_fn = pair.second;
+
+    printf("\nProcessing compact memory layout for %s...\n", path.c_str());
+
+    printf("  Ordering memory...");
+    auto table = flatten_fsm_compact<hand_size>(fsm, layout_fn(fsm));
+    printf("  Done.\n");
+
+    size_t num_bytes = sizeof(CompactPheHeader) +
+                       table.interior.size() * sizeof(uint32_t) +
+                       table.terminal.size() * sizeof(uint16_t);
+    auto filesize_str = human_readable_filesize(num_bytes);
+    printf("  Table size: %zu bytes (%s).\n", num_bytes, filesize_str.c_str());
+
+    printf("  Saving table...");
+    save_compact_lookup_table<hand_size>(table, path);
+    printf("  Done.\n");
+  }
+}
+
+template <uint8_t hand_size>
+std::vector<Score> compute_bootstrap_scores(EvalFn eval_fn, size_t num_threads) {
+  printf("\nComputing bootstrap scores of hands of size %d...", hand_size);
+  fflush(stdout);
+  auto start_time = std::chrono::steady_clock::now();
+  auto scores = bootstrap_scores<hand_size>(eval_fn, num_threads);
+  auto duration_str = human_readable_duration(std::chrono::steady_clock::now() - start_time);
+  printf("  Done; took %s\n", duration_str.c_str());
+  return scores;
+}
+
+// Validates unified tables on hands of size hand_size to max_hand_size, one
+// sweep per size, adding up the mismatches of each table.
+template <uint8_t min_hand_size, uint8_t max_hand_size, uint8_t hand_size>
+void validate_unified_phes(const std::vector<UnifiedPokerHandEval<min_hand_size, max_hand_size>>& phes,
+                           const std::vector<std::string>& paths,
+                           EvalFn eval_fn,
+                           const std::vector<Score>& max_hand_size_scores,
+                           size_t num_threads,
+                           std::vector<uint64_t>* mismatches) {
+  std::vector<EvaluatorWalker<hand_size>> walkers;
+  for (const auto& phe : phes) {
+    walkers.push_back(evaluator_walker<hand_size>(phe));
+  }
+  std::vector<uint64_t> counts;
+  if constexpr (hand_size == max_hand_size) {
+    counts = validate_saved_tables<hand_size>(paths, walkers, max_hand_size_scores, num_threads);
+  } else {
+    auto expected = compute_bootstrap_scores<hand_size>(eval_fn, num_threads);
+    counts = validate_saved_tables<hand_size>(paths, walkers, expected, num_threads);
+  }
+  for (size_t i = 0; i < counts.size(); i++) {
+    (*mismatches)[i] += counts[i];
+  }
+  if constexpr (hand_size < max_hand_size) {
+    validate_unified_phes<min_hand_size, max_hand_size, hand_size + 1>(phes, paths, eval_fn, max_hand_size_scores,
+                                                                       num_threads, mismatches);
   }
 }
 
@@ -144,10 +473,13 @@ void save_phes(
 template <uint8_t hand_size>
 void build_phes(
     EvalFn eval_fn,
-    const std::map<std::string, MemoryLayoutFn<hand_size>>& layout_files) {
+    const std::map<std::string, MemoryLayoutFn<hand_size>>& layout_files,
+    const std::map<std::string, MemoryLayoutFn<hand_size>>& compact_layout_files,
+    size_t num_threads,
+    const std::map<std::string, RowPlacement>& row_placements) {
   printf("\nBuilding FSM for hands of size %d...\n", hand_size);
   auto start_time = std::chrono::system_clock::now();
-  auto fsm = build_fsm<hand_size>(eval_fn);
+  auto fsm = build_fsm<hand_size>(eval_fn, num_threads);
   auto end_time = std::chrono::system_clock::now();
   printf("Done.\n");
 
@@ -159,14 +491,157 @@ void build_phes(
   auto filesize_str = human_readable_filesize(num_bytes);
   printf("Table size: %zu bytes (%s).\n", num_bytes, filesize_str.c_str());
 
+  auto expected = compute_bootstrap_scores<hand_size>(eval_fn, num_threads);
+
   printf("\nValidating FSM... ");
-  if (!validate_fsm<hand_size>(fsm, eval_fn)) {
+  if (!validate_fsm<hand_size>(FsmWalker{&fsm}, expected, num_threads)) {
     printf("Failed!\n");
     return;
   }
   printf("Done.\n");
 
-  save_phes<hand_size>(fsm, layout_files, eval_fn);
+  save_phes<hand_size>(fsm, layout_files, row_placements);
+  save_compact_phes<hand_size>(fsm, compact_layout_files);
+
+  // Every table is loaded back through its evaluator and checked in one
+  // sweep. The evaluators must not move once walkers point at them.
+  std::vector<std::string> paths;
+  std::vector<PokerHandEval<hand_size>> phes;
+  std::vector<CompactPokerHandEval<hand_size>> compact_phes;
+  std::vector<EvaluatorWalker<hand_size>> walkers;
+  phes.reserve(layout_files.size());
+  compact_phes.reserve(compact_layout_files.size());
+  for (const auto& pair : layout_files) {
+    paths.push_back(pair.first);
+    phes.emplace_back(pair.first);
+    walkers.push_back(evaluator_walker<hand_size>(phes.back()));
+  }
+  for (const auto& pair : compact_layout_files) {
+    paths.push_back(pair.first);
+    compact_phes.emplace_back(pair.first);
+    walkers.push_back(evaluator_walker<hand_size>(compact_phes.back()));
+  }
+  if (!paths.empty()) {
+    remove_failed_tables(paths, validate_saved_tables<hand_size>(paths, walkers, expected, num_threads));
+  }
+}
+
+template <uint8_t hand_size>
+void build_suit_canonical_phes(
+    EvalFn eval_fn,
+    const CardSuits& card_suits,
+    const std::map<std::string, MemoryLayoutFn<hand_size>>& layout_files,
+    size_t num_threads) {
+  printf("\nBuilding suit-canonical FSM for hands of size %d...\n", hand_size);
+  auto start_time = std::chrono::system_clock::now();
+  auto fsm = build_suit_canonical_fsm<hand_size>(eval_fn, card_suits, num_threads);
+  auto relabel = build_suit_relabel_table(card_suits);
+  auto end_time = std::chrono::system_clock::now();
+  printf("Done.\n");
+
+  auto duration_str = human_readable_duration(end_time - start_time);
+  printf("\nTook: %s\n", duration_str.c_str());
+
+  printf("\nNum states: %zu.\n", fsm.size());
+  size_t num_bytes = 52 * fsm.size() * sizeof(uint32_t) + relabel.size() * sizeof(uint16_t);
+  auto filesize_str = human_readable_filesize(num_bytes);
+  printf("Table size: %zu bytes (%s).\n", num_bytes, filesize_str.c_str());
+
+  auto expected = compute_bootstrap_scores<hand_size>(eval_fn, num_threads);
+
+  printf("\nValidating FSM... ");
+  if (!validate_fsm<hand_size>(SuitCanonicalFsmWalker{&fsm, &relabel}, expected, num_threads)) {
+    printf("Failed!\n");
+    return;
+  }
+  printf("Done.\n");
+
+  for (const auto& pair : layout_files) {
+    const auto& path = pair.first;
+    const auto& layout_fn = pair.second;
+
+    printf("\nProcessing memory layout for %s...\n", path.c_str());
+
+    printf("  Ordering memory...");
+    auto table = flatten_fsm<hand_size>(fsm, layout_fn(fsm));
+    printf("  Done.\n");
+
+    printf("  Saving table...");
+    save_suit_canonical_lookup_table(relabel, table, path);
+    printf("  Done.\n");
+  }
+
+  std::vector<std::string> paths;
+  std::vector<SuitCanonicalPokerHandEval<hand_size>> phes;
+  std::vector<EvaluatorWalker<hand_size>> walkers;
+  phes.reserve(layout_files.size());
+  for (const auto& pair : layout_files) {
+    paths.push_back(pair.first);
+    phes.emplace_back(pair.first);
+    walkers.push_back(evaluator_walker<hand_size>(phes.back()));
+  }
+  if (!paths.empty()) {
+    remove_failed_tables(paths, validate_saved_tables<hand_size>(paths, walkers, expected, num_threads));
+  }
+}
+
+template <uint8_t min_hand_size, uint8_t max_hand_size>
+void build_unified_phes(
+    EvalFn eval_fn,
+    const std::map<std::string, MemoryLayoutFn<max_hand_size>>& layout_files,
+    size_t num_threads) {
+  printf("\nBuilding unified FSM for hands of size %d to %d...\n", min_hand_size, max_hand_size);
+  auto start_time = std::chrono::system_clock::now();
+  auto fsm = build_unified_fsm<max_hand_size>(eval_fn, min_hand_size, num_threads);
+  auto end_time = std::chrono::system_clock::now();
+  printf("Done.\n");
+
+  auto duration_str = human_readable_duration(end_time - start_time);
+  printf("\nTook: %s\n", duration_str.c_str());
+
+  printf("\nNum states: %zu.\n", fsm.size());
+  size_t num_bytes = sizeof(UnifiedPheHeader) + kUnifiedRowSize * fsm.size() * sizeof(uint32_t);
+  auto filesize_str = human_readable_filesize(num_bytes);
+  printf("Table size: %zu bytes (%s).\n", num_bytes, filesize_str.c_str());
+
+  auto expected = compute_bootstrap_scores<max_hand_size>(eval_fn, num_threads);
+
+  printf("\nValidating FSM... ");
+  if (!validate_fsm<max_hand_size>(FsmWalker{&fsm}, expected, num_threads)) {
+    printf("Failed!\n");
+    return;
+  }
+  printf("Done.\n");
+
+  for (const auto& pair : layout_files) {
+    const auto& path = pair.first;
+    const auto& layout_fn = pair.second;
+
+    printf("\nProcessing memory layout for %s...\n", path.c_str());
+
+    printf("  Ordering memory...");
+    auto table = flatten_fsm_unified<max_hand_size>(fsm, layout_fn(fsm));
+    printf("  Done.\n");
+
+    printf("  Saving table...");
+    save_unified_lookup_table(table, min_hand_size, max_hand_size, path);
+    printf("  Done.\n");
+  }
+
+  // Unified tables score every size they cover, so each size gets a sweep.
+  std::vector<std::string> paths;
+  std::vector<UnifiedPokerHandEval<min_hand_size, max_hand_size>> phes;
+  phes.reserve(layout_files.size());
+  for (const auto& pair : layout_files) {
+    paths.push_back(pair.first);
+    phes.emplace_back(pair.first);
+  }
+  if (!paths.empty()) {
+    std::vector<uint64_t> mismatches(paths.size());
+    validate_unified_phes<min_hand_size, max_hand_size, min_hand_size>(phes, paths, eval_fn, expected, num_threads,
+                                                                      &mismatches);
+    remove_failed_tables(paths, mismatches);
+  }
 }
 
 }  // namespace poker_eval
@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "generate_tables/compress.h"
+#include "poker_hand_eval.h"
+
+using namespace poker_eval;
+
+namespace {
+
+// "tables/bfs7.phe" -> "bfs7".
+std::string file_stem(const std::string& path) {
+  size_t begin = path.find_last_of('/');
+  begin = (begin == std::string::npos ? 0 : begin + 1);
+  size_t end = path.find('.', begin);
+  return path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+// Compresses a *.phe table into the *.phez format, then checks that it loads
+// back to the original bytes.
+//
+// Usage: phe_compress [--hand-size N] [--layout NAME] [--rows-per-chunk N]
+//                     [--threads N] in.phe out.phez
+//
+// The hand size and layout default to those spelled by the file name, as in
+// bfs7.phe. Suit-canonical and compact tables are not supported.
+int main(int argc, char** argv) {
+  CompressedTableInfo info;
+  size_t num_threads = 0;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--hand-size" && i + 1 < argc) {
+      info.hand_size = std::stoul(argv[++i]);
+    } else if (arg == "--layout" && i + 1 < argc) {
+      info.layout = argv[++i];
+    } else if (arg == "--rows-per-chunk" && i + 1 < argc) {
+      info.rows_per_chunk = std::stoul(argv[++i]);
+    } else if (arg == "--threads" && i + 1 < argc) {
+      num_threads = std::stoul(argv[++i]);
+    } else if (arg.rfind("--", 0) != 0) {
+      paths.push_back(arg);
+    } else {
+      paths.clear();
+      break;
+    }
+  }
+  if (paths.size() != 2) {
+    fprintf(stderr,
+            "Usage: %s [--hand-size N] [--layout NAME] [--rows-per-chunk N] [--threads N] in.phe out.phez\n",
+            argv[0]);
+    return 1;
+  }
+  const std::string& in_path = paths[0];
+  const std::string& out_path = paths[1];
+
+  std::string stem = file_stem(in_path);
+  size_t digits = stem.find_last_not_of("0123456789") + 1;
+  if (info.hand_size == 0 && digits < stem.size()) {
+    info.hand_size = std::stoul(stem.substr(digits));
+  }
+  if (info.layout.empty()) {
+    info.layout = stem.substr(0, digits);
+  }
+  if (info.hand_size == 0) {
+    fprintf(stderr, "%s: cannot infer the hand size, pass --hand-size\n", in_path.c_str());
+    return 1;
+  }
+
+  std::ifstream file(in_path, std::ios::in | std::ios::binary);
+  file.seekg(0, std::ios::end);
+  size_t num_bytes = file.tellg();
+  file.seekg(0, std::ios::beg);
+  if (!file || num_bytes % (52 * sizeof(uint32_t)) != 0) {
+    fprintf(stderr, "%s: not a table of 52-slot rows\n", in_path.c_str());
+    return 1;
+  }
+  std::vector<uint32_t> table(num_bytes / sizeof(uint32_t));
+  file.read(reinterpret_cast<char*>(table.data()), num_bytes);
+  file.close();
+
+  printf("Compressing %s (hand size %u, layout %s)...", in_path.c_str(), info.hand_size, info.layout.c_str());
+  auto start_time = std::chrono::steady_clock::now();
+  save_compressed_lookup_table(table, info, out_path, num_threads);
+  printf("  Done in %.0f ms.\n", elapsed_ms(start_time));
+
+  std::ifstream out_file(out_path, std::ios::in | std::ios::binary | std::ios::ate);
+  size_t out_bytes = out_file.tellg();
+  printf("  %zu -> %zu bytes (%.2fx).\n", num_bytes, out_bytes, static_cast<double>(num_bytes) / out_bytes);
+
+  printf("Verifying %s...", out_path.c_str());
+  PheLoadOptions options;
+  options.decode_threads = num_threads;
+  start_time = std::chrono::steady_clock::now();
+  size_t decoded_bytes = 0;
+  auto decoded = details::load_table(out_path, options, &decoded_bytes, info.hand_size);
+  double decode_ms = elapsed_ms(start_time);
+  if (decoded_bytes != num_bytes || std::memcmp(decoded.get(), table.data(), num_bytes) != 0) {
+    printf("  Failed.\n");
+    std::remove(out_path.c_str());
+    return 1;
+  }
+  printf("  Done; decoded in %.0f ms.\n", decode_ms);
+}
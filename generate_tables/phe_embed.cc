@@ -0,0 +1,73 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// "tables/bfs5.phe" -> "bfs5".
+std::string file_stem(const std::string& path) {
+  size_t begin = path.find_last_of('/');
+  begin = (begin == std::string::npos ? 0 : begin + 1);
+  size_t end = path.find('.', begin);
+  return path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+// Larger tables are slow to compile as an initializer; link them in with
+// embedded_table.S instead.
+constexpr size_t kMaxBytes = size_t{4} << 20;
+
+}  // namespace
+
+// Writes a *.phe table as a C++ header holding a constexpr array, named after
+// the file: tables/bfs5.phe becomes phe_table_bfs5, with phe_table_bfs5_size
+// entries.
+//
+// Usage: phe_embed in.phe out.h
+//
+// The array is usable wherever embedded_table.h tables are:
+//   PokerHandEval<5> phe(phe_table_bfs5, phe_table_bfs5_size);
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s in.phe out.h\n", argv[0]);
+    return 1;
+  }
+  const std::string in_path = argv[1];
+  const std::string out_path = argv[2];
+  const std::string name = "phe_table_" + file_stem(in_path);
+
+  std::ifstream file(in_path, std::ios::in | std::ios::binary);
+  file.seekg(0, std::ios::end);
+  size_t num_bytes = file.tellg();
+  file.seekg(0, std::ios::beg);
+  if (!file || num_bytes % (52 * sizeof(uint32_t)) != 0) {
+    fprintf(stderr, "%s: not a table of 52-slot rows\n", in_path.c_str());
+    return 1;
+  }
+  if (num_bytes > kMaxBytes) {
+    fprintf(stderr, "%s: too large for a header; use embedded_table.S\n", in_path.c_str());
+    return 1;
+  }
+  std::vector<uint32_t> table(num_bytes / sizeof(uint32_t));
+  file.read(reinterpret_cast<char*>(table.data()), num_bytes);
+
+  FILE* out = fopen(out_path.c_str(), "w");
+  if (out == nullptr) {
+    perror(out_path.c_str());
+    return 1;
+  }
+  fprintf(out, "// Generated by phe_embed from %s. Do not edit.\n", in_path.c_str());
+  fprintf(out, "#pragma once\n\n#include <cstddef>\n#include <cstdint>\n\n");
+  fprintf(out, "alignas(64) inline constexpr uint32_t %s[] = {", name.c_str());
+  for (size_t i = 0; i < table.size(); i++) {
+    fprintf(out, "%s%u,", i % 52 == 0 ? "\n" : "", table[i]);
+  }
+  fprintf(out, "\n};\n\n");
+  fprintf(out, "inline constexpr size_t %s_size = %zu;\n", name.c_str(), table.size());
+  if (fclose(out) != 0) {
+    perror(out_path.c_str());
+    std::remove(out_path.c_str());
+    return 1;
+  }
+}
@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "poker_hand_eval.h"
+
+namespace {
+
+// Record formats. Both are read in place, straight out of the mapped file or
+// the read buffer.
+//
+// packed: hand_size card bytes per hand, e.g. 7-byte records for bfs7.phe.
+// encoded: 8 bytes per hand, laid out as an EncodedHand of
+// generate_tables/common.h: one byte of hand size, then 7 card bytes of which
+// the first hand_size are used.
+template <uint8_t hand_size>
+using PackedRecord = std::array<uint8_t, hand_size>;
+
+struct EncodedRecord {
+  uint8_t size;
+  uint8_t cards[7];
+
+  // Lets eval_batch walk the cards as it would a container's.
+  const uint8_t* begin() const { return cards; }
+};
+static_assert(sizeof(EncodedRecord) == 8, "EncodedRecord must match EncodedHand.");
+
+// Score written for records that are not a valid hand.
+constexpr uint32_t kInvalidScore = UINT32_MAX;
+
+template <uint8_t hand_size>
+bool is_valid(const PackedRecord<hand_size>& record) {
+  uint8_t max_card = 0;
+  for (uint8_t card : record) {
+    max_card = std::max(max_card, card);
+  }
+  return max_card < 52;
+}
+
+template <uint8_t hand_size>
+bool is_valid(const EncodedRecord& record) {
+  uint8_t max_card = 0;
+  for (uint8_t i = 0; i < hand_size; i++) {
+    max_card = std::max(max_card, record.cards[i]);
+  }
+  return record.size == hand_size && max_card < 52;
+}
+
+// Evaluates n records into out[0..n), kBatchLanes at a time. Out-of-range
+// cards would walk off the table, so each group is checked first; a group
+// holding an invalid record falls back to one hand at a time. Returns the
+// number of invalid records.
+template <uint8_t hand_size, typename Record>
+size_t eval_records(const PokerHandEval<hand_size>& phe, const Record* in, uint32_t* out, size_t n) {
+  size_t num_invalid = 0;
+  for (size_t i = 0; i < n; i += details::kBatchLanes) {
+    size_t num_lanes = std::min(details::kBatchLanes, n - i);
+    bool all_valid = true;
+    for (size_t lane = 0; lane < num_lanes; lane++) {
+      all_valid &= is_valid<hand_size>(in[i + lane]);
+    }
+    if (all_valid) {
+      phe.eval_batch(in + i, out + i, num_lanes);
+      continue;
+    }
+    for (size_t lane = 0; lane < num_lanes; lane++) {
+      if (is_valid<hand_size>(in[i + lane])) {
+        phe.eval_batch(in + i + lane, out + i + lane, 1);
+      } else {
+        out[i + lane] = kInvalidScore;
+        num_invalid++;
+      }
+    }
+  }
+  return num_invalid;
+}
+
+// Writes all of [data, data + num_bytes) to fd.
+bool write_all(int fd, const void* data, size_t num_bytes) {
+  const char* p = static_cast<const char*>(data);
+  while (num_bytes > 0) {
+    ssize_t n = write(fd, p, num_bytes);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    num_bytes -= n;
+  }
+  return true;
+}
+
+// Reads up to num_bytes from fd, stopping early only at end of file. Returns
+// the number of bytes read, or -1 on error.
+ssize_t read_full(int fd, void* data, size_t num_bytes) {
+  char* p = static_cast<char*>(data);
+  size_t total = 0;
+  while (total < num_bytes) {
+    ssize_t n = read(fd, p + total, num_bytes - total);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return -1;
+    }
+    if (n == 0) {
+      break;
+    }
+    total += n;
+  }
+  return total;
+}
+
+// "tables/bfs7.phe" -> "bfs7".
+std::string file_stem(const std::string& path) {
+  size_t begin = path.find_last_of('/');
+  begin = (begin == std::string::npos ? 0 : begin + 1);
+  size_t end = path.find('.', begin);
+  return path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+struct Options {
+  std::string table_path;
+  std::string in_path = "-";
+  std::string out_path = "-";
+  uint32_t hand_size = 0;
+  bool encoded = false;
+  bool u16 = false;
+  size_t num_threads = 0;
+  size_t chunk_records = size_t{1} << 20;
+  bool verbose = false;
+};
+
+// One buffer of the pipeline. The reader fills `records` (or points it into
+// the mapped input), the evaluator fills `scores`, the writer drains them.
+struct Slot {
+  enum class State { kFree, kRead, kEvaluated };
+
+  State state = State::kFree;
+  std::vector<uint8_t> buffer;
+  const uint8_t* records = nullptr;
+  size_t num_records = 0;
+  std::vector<uint32_t> scores;
+  bool last = false;
+};
+
+// Streams records from in_fd to scores on out_fd through two slots, so that
+// reading chunk k + 1, evaluating chunk k and writing chunk k - 1 overlap as
+// far as two buffers allow. Returns false on error, after reporting it.
+template <uint8_t hand_size>
+bool run(const Options& options, int in_fd, int out_fd) {
+  PokerHandEval<hand_size> phe(options.table_path);
+  const size_t record_bytes = options.encoded ? sizeof(EncodedRecord) : hand_size;
+  const size_t num_threads = details::resolve_num_threads(options.num_threads);
+
+  // Regular files are mapped and read in place; pipes are read into the
+  // slots' buffers.
+  struct stat st;
+  if (fstat(in_fd, &st) != 0) {
+    perror(options.in_path.c_str());
+    return false;
+  }
+  const uint8_t* mapped = nullptr;
+  size_t mapped_bytes = 0;
+  if (S_ISREG(st.st_mode) && st.st_size > 0) {
+    mapped_bytes = st.st_size;
+    if (mapped_bytes % record_bytes != 0) {
+      fprintf(stderr, "%s: size is not a multiple of %zu-byte records\n", options.in_path.c_str(), record_bytes);
+      return false;
+    }
+    void* addr = mmap(nullptr, mapped_bytes, PROT_READ, MAP_PRIVATE, in_fd, 0);
+    if (addr == MAP_FAILED) {
+      perror(("mmap " + options.in_path).c_str());
+      return false;
+    }
+    madvise(addr, mapped_bytes, MADV_SEQUENTIAL);
+    mapped = static_cast<const uint8_t*>(addr);
+  }
+
+  Slot slots[2];
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::atomic<bool> failed{false};
+  auto fail = [&](const std::string& message) {
+    fprintf(stderr, "%s\n", message.c_str());
+    std::lock_guard<std::mutex> lock(mutex);
+    failed = true;
+    changed.notify_all();
+  };
+  // Waits until `slot` is in `state`; returns false if the pipeline failed.
+  auto wait_for = [&](Slot& slot, Slot::State state) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return slot.state == state || failed; });
+    return !failed;
+  };
+  auto hand_over = [&](Slot& slot, Slot::State state) {
+    std::lock_guard<std::mutex> lock(mutex);
+    slot.state = state;
+    changed.notify_all();
+  };
+
+  std::thread reader([&] {
+    size_t offset = 0;
+    for (size_t k = 0;; k++) {
+      Slot& slot = slots[k % 2];
+      if (!wait_for(slot, Slot::State::kFree)) {
+        return;
+      }
+      if (mapped != nullptr) {
+        size_t num_bytes = std::min(options.chunk_records * record_bytes, mapped_bytes - offset);
+        slot.records = mapped + offset;
+        slot.num_records = num_bytes / record_bytes;
+        // Fault the chunk in while the previous one is being evaluated.
+        size_t page_offset = offset % sysconf(_SC_PAGESIZE);
+        madvise(const_cast<uint8_t*>(slot.records - page_offset), num_bytes + page_offset, MADV_WILLNEED);
+        offset += num_bytes;
+        slot.last = offset == mapped_bytes;
+      } else {
+        slot.buffer.resize(options.chunk_records * record_bytes);
+        ssize_t num_bytes = read_full(in_fd, slot.buffer.data(), slot.buffer.size());
+        if (num_bytes < 0) {
+          fail("read " + options.in_path + ": " + strerror(errno));
+          return;
+        }
+        if (num_bytes % record_bytes != 0) {
+          fail(options.in_path + ": truncated record at end of input");
+          return;
+        }
+        slot.records = slot.buffer.data();
+        slot.num_records = num_bytes / record_bytes;
+        slot.last = static_cast<size_t>(num_bytes) < slot.buffer.size();
+      }
+      bool last = slot.last;
+      hand_over(slot, Slot::State::kRead);
+      if (last) {
+        return;
+      }
+    }
+  });
+
+  std::thread writer([&] {
+    std::vector<uint16_t> narrowed;
+    for (size_t k = 0;; k++) {
+      Slot& slot = slots[k % 2];
+      if (!wait_for(slot, Slot::State::kEvaluated)) {
+        return;
+      }
+      const void* data = slot.scores.data();
+      size_t num_bytes = slot.num_records * sizeof(uint32_t);
+      if (options.u16) {
+        narrowed.assign(slot.scores.begin(), slot.scores.begin() + slot.num_records);
+        data = narrowed.data();
+        num_bytes = slot.num_records * sizeof(uint16_t);
+      }
+      if (!write_all(out_fd, data, num_bytes)) {
+        fail("write " + options.out_path + ": " + strerror(errno));
+        return;
+      }
+      bool last = slot.last;
+      hand_over(slot, Slot::State::kFree);
+      if (last) {
+        return;
+      }
+    }
+  });
+
+  // Evaluation runs on this thread and its workers, one chunk at a time.
+  const size_t records_per_task = std::max<size_t>(details::kBatchLanes, options.chunk_records / (4 * num_threads));
+  size_t num_records = 0;
+  std::atomic<size_t> num_invalid{0};
+  auto start_time = std::chrono::steady_clock::now();
+  for (size_t k = 0;; k++) {
+    Slot& slot = slots[k % 2];
+    if (!wait_for(slot, Slot::State::kRead)) {
+      break;
+    }
+    slot.scores.resize(slot.num_records);
+    size_t num_tasks = (slot.num_records + records_per_task - 1) / records_per_task;
+    details::run_work_stealing(num_tasks, std::min(num_threads, std::max<size_t>(num_tasks, 1)), [&](size_t, size_t task) {
+      size_t begin = task * records_per_task;
+      size_t n = std::min(records_per_task, slot.num_records - begin);
+      size_t invalid = 0;
+      if (options.encoded) {
+        auto in = reinterpret_cast<const EncodedRecord*>(slot.records);
+        invalid = eval_records<hand_size>(phe, in + begin, slot.scores.data() + begin, n);
+      } else {
+        auto in = reinterpret_cast<const PackedRecord<hand_size>*>(slot.records);
+        invalid = eval_records<hand_size>(phe, in + begin, slot.scores.data() + begin, n);
+      }
+      num_invalid += invalid;
+    });
+    num_records += slot.num_records;
+    bool last = slot.last;
+    hand_over(slot, Slot::State::kEvaluated);
+    if (last) {
+      break;
+    }
+  }
+  reader.join();
+  writer.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+  if (mapped != nullptr) {
+    munmap(const_cast<uint8_t*>(mapped), mapped_bytes);
+  }
+  if (failed) {
+    return false;
+  }
+  if (options.verbose) {
+    fprintf(stderr, "%zu hands in %.3f s (%.1f M hands/s, %.0f MB/s in)\n", num_records, seconds,
+            num_records / seconds / 1e6, num_records * record_bytes / seconds / 1e6);
+  }
+  if (num_invalid > 0) {
+    fprintf(stderr, "%zu invalid records scored as %#x\n", num_invalid.load(), options.u16 ? 0xffffu : kInvalidScore);
+  }
+  return true;
+}
+
+}  // namespace
+
+// Scores a file of hands with a table, in bulk.
+//
+// Usage: phe_eval [--hand-size N] [--encoded] [--u16] [--threads N]
+//                 [--chunk N] [-o out] [-v] table.phe [in]
+//
+// Reads packed records of hand_size card bytes from `in`, or 8-byte
+// EncodedHand records with --encoded, and writes one native-endian uint32_t
+// score per record (uint16_t with --u16) in the same order. `in` and `-o`
+// default to stdin and stdout. Records with a card out of range, or an
+// encoded size other than hand_size, score UINT32_MAX (0xffff with --u16).
+//
+// The hand size defaults to the one spelled by the table name, as in
+// bfs7.phe.
+int main(int argc, char** argv) {
+  Options options;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--hand-size" && i + 1 < argc) {
+      options.hand_size = std::stoul(argv[++i]);
+    } else if (arg == "--encoded") {
+      options.encoded = true;
+    } else if (arg == "--u16") {
+      options.u16 = true;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      options.num_threads = std::stoul(argv[++i]);
+    } else if (arg == "--chunk" && i + 1 < argc) {
+      options.chunk_records = std::max<size_t>(std::stoul(argv[++i]), 1);
+    } else if (arg == "-o" && i + 1 < argc) {
+      options.out_path = argv[++i];
+    } else if (arg == "-v") {
+      options.verbose = true;
+    } else if (arg == "-" || arg.rfind("-", 0) != 0) {
+      paths.push_back(arg);
+    } else {
+      paths.clear();
+      break;
+    }
+  }
+  if (paths.empty() || paths.size() > 2) {
+    fprintf(stderr,
+            "Usage: %s [--hand-size N] [--encoded] [--u16] [--threads N] [--chunk N] [-o out] [-v] table.phe [in]\n",
+            argv[0]);
+    return 1;
+  }
+  options.table_path = paths[0];
+  if (paths.size() == 2) {
+    options.in_path = paths[1];
+  }
+
+  std::string stem = file_stem(options.table_path);
+  size_t digits = stem.find_last_not_of("0123456789") + 1;
+  if (options.hand_size == 0 && digits < stem.size()) {
+    options.hand_size = std::stoul(stem.substr(digits));
+  }
+  if (options.hand_size != 5 && options.hand_size != 7) {
+    fprintf(stderr, "%s: cannot infer a hand size of 5 or 7, pass --hand-size\n", options.table_path.c_str());
+    return 1;
+  }
+
+  int in_fd = STDIN_FILENO;
+  if (options.in_path != "-") {
+    in_fd = open(options.in_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in_fd < 0) {
+      perror(options.in_path.c_str());
+      return 1;
+    }
+  }
+  int out_fd = STDOUT_FILENO;
+  if (options.out_path != "-") {
+    out_fd = open(options.out_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out_fd < 0) {
+      perror(options.out_path.c_str());
+      return 1;
+    }
+  }
+
+  bool ok = false;
+  try {
+    ok = options.hand_size == 5 ? run<5>(options, in_fd, out_fd) : run<7>(options, in_fd, out_fd);
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+  }
+  if (out_fd != STDOUT_FILENO && close(out_fd) != 0) {
+    perror(options.out_path.c_str());
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,490 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "poker_hand_eval.h"
+
+// Instrumentation policy for PokerHandEval that counts, on every thread:
+//   * evaluations;
+//   * visits of every row of the table, as a RowHistogram;
+//   * the distinct cache lines and pages touched at every level of the walk;
+//   * the latency of one evaluation in every latency_sample_period(),
+//     in power-of-two buckets of nanoseconds.
+// Counters are kept per (thread, evaluator), and summed over threads when
+// read.
+//
+// Example usage:
+//   PokerHandEval<7, CountingInstrumentation> phe("/path/to/bfs7.phe");
+//   ... phe.eval(...) on any number of threads ...
+//   CountingInstrumentation::write_json(std::cout);
+//
+// Only the owning thread writes its counters, with plain loads and stores, so
+// the hot path takes no locks and no atomic read-modify-writes. The first
+// evaluation of a thread on a table allocates that thread's counters (about
+// 8 bytes per row, plus 1 bit per cache line per level).
+//
+// To read the counters of a running process, see InstrumentationDumper.
+class CountingInstrumentation {
+ public:
+  static constexpr bool kEnabled = true;
+  // Bucket b counts latencies in [2^b, 2^(b+1)) ns; bucket 0 also holds 0 ns.
+  static constexpr size_t kLatencyBuckets = 40;
+
+  // Times one evaluation in every `period` on each thread; 0 turns timing
+  // off. Defaults to 1024.
+  static void set_latency_sample_period(uint32_t period) { sample_period().store(period); }
+  static uint32_t latency_sample_period() { return sample_period().load(); }
+
+  // Counters of one table, summed over threads.
+  struct TableStats {
+    // Identifies the table; only meaningful while it is loaded.
+    const uint32_t* table = nullptr;
+    // Tells apart evaluators of tables loaded at the same address in turn.
+    uint64_t generation = 0;
+    uint32_t hand_size = 0;
+    uint64_t evaluations = 0;
+    RowHistogram rows{0, 0};
+    // Distinct cache lines and pages loaded at each level, level 0 being the
+    // root row.
+    std::vector<uint64_t> cache_lines;
+    std::vector<uint64_t> pages;
+    std::array<uint64_t, kLatencyBuckets> latency_ns{};
+    uint64_t latency_samples = 0;
+  };
+
+  struct ThreadStats {
+    // Kernel thread ID.
+    pid_t tid = 0;
+    uint64_t evaluations = 0;
+  };
+
+  struct Stats {
+    std::vector<ThreadStats> threads;
+    std::vector<TableStats> tables;
+  };
+
+  // Returns a consistent-enough copy of every counter: each counter is read
+  // atomically, but threads keep counting while the copy is taken.
+  static Stats snapshot();
+
+  // Writes snapshot() as JSON, without the row histograms.
+  static void write_json(std::ostream& out) { write_json(snapshot(), out); }
+  static void write_json(const Stats& stats, std::ostream& out);
+
+ private:
+  using Counter = std::atomic<uint64_t>;
+
+  static constexpr size_t kCacheLineSize = 64;
+  static constexpr size_t kPageSize = 4096;
+
+  // Increments a counter only its owning thread writes.
+  static void bump(Counter* counter, uint64_t n = 1) {
+    counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  static void set_bit(std::vector<Counter>* bits, size_t bit) {
+    Counter& word = (*bits)[bit / 64];
+    uint64_t value = word.load(std::memory_order_relaxed);
+    uint64_t mask = uint64_t{1} << (bit % 64);
+    if (!(value & mask)) {
+      word.store(value | mask, std::memory_order_relaxed);
+    }
+  }
+
+  struct ThreadCounters;
+
+  // Every thread's counters, kept after the thread exits.
+  struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadCounters>> threads;
+  };
+
+  static Registry& registry() {
+    static Registry* registry = new Registry();  // Never destroyed: threads may outlive main.
+    return *registry;
+  }
+
+  static std::atomic<uint32_t>& sample_period() {
+    static std::atomic<uint32_t> period{1024};
+    return period;
+  }
+
+  struct TableCounters;
+
+  // The calling thread's counters for the evaluator of `generation`, created
+  // on first use.
+  static TableCounters* table_counters(const uint32_t* table,
+                                       size_t table_size,
+                                       uint32_t hand_size,
+                                       uint64_t generation);
+
+ public:
+  // Called by PokerHandEval::eval.
+  class Probe {
+   public:
+    Probe(const uint32_t* table, size_t table_size, uint32_t hand_size, uint64_t generation);
+
+    void visit(uint32_t level, uint32_t offset);
+    void finish();
+
+   private:
+    TableCounters* counters_;
+    std::chrono::steady_clock::time_point start_;
+    bool sampled_ = false;
+  };
+};
+
+// Dumps CountingInstrumentation counters whenever the process receives a
+// signal, e.g. `kill -USR1 <pid>`.
+//
+// Each dump writes the JSON of CountingInstrumentation::write_json to `path`,
+// and the row histogram of every table to `path`.<i>.hist, which
+// generate_tables turns into a profile-guided layout. Files are replaced
+// atomically. The signal handler only writes a byte to a pipe; a background
+// thread does the dumping.
+//
+// Example usage:
+//   InstrumentationDumper dumper("/tmp/phe_counters.json");
+//
+// At most one dumper may exist at a time.
+class InstrumentationDumper {
+ public:
+  explicit InstrumentationDumper(const std::string& path, int signal = SIGUSR1);
+  InstrumentationDumper(const InstrumentationDumper&) = delete;
+  ~InstrumentationDumper();
+
+  // Dumps now, from the calling thread.
+  void dump() const;
+
+ private:
+  static void on_signal(int);
+
+  static std::atomic<int>& write_fd() {
+    static std::atomic<int> fd{-1};
+    return fd;
+  }
+
+  std::string path_;
+  int signal_;
+  int pipe_[2] = {-1, -1};
+  struct sigaction previous_action_;
+  std::thread thread_;
+};
+
+//////////////////////////////////
+// Implementation details below //
+//////////////////////////////////
+
+struct CountingInstrumentation::TableCounters {
+  const uint32_t* table;
+  size_t table_size;
+  uint32_t hand_size;
+  uint64_t generation;
+  Counter evaluations{0};
+  std::vector<Counter> rows;
+  std::vector<std::vector<Counter>> cache_lines;
+  std::vector<std::vector<Counter>> pages;
+  std::array<Counter, kLatencyBuckets> latency_ns{};
+  Counter latency_samples{0};
+
+  TableCounters(const uint32_t* table, size_t table_size, uint32_t hand_size, uint64_t generation)
+      : table(table),
+        table_size(table_size),
+        hand_size(hand_size),
+        generation(generation),
+        rows((table_size + 51) / 52),
+        cache_lines(hand_size),
+        pages(hand_size) {
+    size_t num_bytes = table_size * sizeof(uint32_t);
+    for (uint32_t level = 0; level < hand_size; level++) {
+      cache_lines[level] = std::vector<Counter>((num_bytes / kCacheLineSize + 64) / 64);
+      pages[level] = std::vector<Counter>((num_bytes / kPageSize + 64) / 64);
+    }
+  }
+
+  // Whether these are the counters of the given evaluator. The address alone
+  // is not enough: a table freed and another loaded in its place, or two
+  // evaluators over one buffer, would share counters sized for the first.
+  bool matches(const uint32_t* t, size_t size, uint32_t hand, uint64_t gen) const {
+    return table == t && table_size == size && hand_size == hand && generation == gen;
+  }
+};
+
+struct CountingInstrumentation::ThreadCounters {
+  pid_t tid;
+  // Guarded by the registry mutex; the counters themselves are not.
+  std::vector<std::unique_ptr<TableCounters>> tables;
+};
+
+inline CountingInstrumentation::TableCounters* CountingInstrumentation::table_counters(const uint32_t* table,
+                                                                                      size_t table_size,
+                                                                                      uint32_t hand_size,
+                                                                                      uint64_t generation) {
+  thread_local ThreadCounters* self = nullptr;
+  thread_local TableCounters* last = nullptr;
+  if (last != nullptr && last->matches(table, table_size, hand_size, generation)) {
+    return last;
+  }
+
+  std::lock_guard<std::mutex> lock(registry().mutex);
+  if (self == nullptr) {
+    registry().threads.push_back(std::make_unique<ThreadCounters>());
+    self = registry().threads.back().get();
+    self->tid = static_cast<pid_t>(syscall(SYS_gettid));
+  }
+  for (auto& counters : self->tables) {
+    if (counters->matches(table, table_size, hand_size, generation)) {
+      return last = counters.get();
+    }
+  }
+  self->tables.push_back(std::make_unique<TableCounters>(table, table_size, hand_size, generation));
+  return last = self->tables.back().get();
+}
+
+inline CountingInstrumentation::Probe::Probe(const uint32_t* table,
+                                             size_t table_size,
+                                             uint32_t hand_size,
+                                             uint64_t generation)
+    : counters_(table_counters(table, table_size, hand_size, generation)) {
+  bump(&counters_->evaluations);
+
+  thread_local uint32_t countdown = 1;
+  uint32_t period = sample_period().load(std::memory_order_relaxed);
+  if (period != 0 && --countdown == 0) {
+    countdown = period;
+    sampled_ = true;
+    start_ = std::chrono::steady_clock::now();
+  }
+}
+
+inline void CountingInstrumentation::Probe::visit(uint32_t level, uint32_t offset) {
+  bump(&counters_->rows[offset / 52]);
+  set_bit(&counters_->cache_lines[level], offset * sizeof(uint32_t) / kCacheLineSize);
+  set_bit(&counters_->pages[level], offset * sizeof(uint32_t) / kPageSize);
+}
+
+inline void CountingInstrumentation::Probe::finish() {
+  if (!sampled_) {
+    return;
+  }
+  uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+  size_t bucket = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+  bump(&counters_->latency_ns[std::min(bucket, kLatencyBuckets - 1)]);
+  bump(&counters_->latency_samples);
+}
+
+inline CountingInstrumentation::Stats CountingInstrumentation::snapshot() {
+  auto or_bits = [](const std::vector<Counter>& bits, std::vector<uint64_t>* out) {
+    out->resize(bits.size());
+    for (size_t i = 0; i < bits.size(); i++) {
+      (*out)[i] |= bits[i].load(std::memory_order_relaxed);
+    }
+  };
+
+  Stats stats;
+  // Union of every thread's bitsets, per table and level.
+  std::vector<std::vector<std::vector<uint64_t>>> cache_lines;
+  std::vector<std::vector<std::vector<uint64_t>>> pages;
+
+  std::lock_guard<std::mutex> lock(registry().mutex);
+  for (const auto& thread : registry().threads) {
+    ThreadStats thread_stats;
+    thread_stats.tid = thread->tid;
+    for (const auto& counters : thread->tables) {
+      uint64_t evaluations = counters->evaluations.load(std::memory_order_relaxed);
+      thread_stats.evaluations += evaluations;
+
+      auto it = std::find_if(stats.tables.begin(), stats.tables.end(), [&](const TableStats& table) {
+        return table.table == counters->table && table.generation == counters->generation;
+      });
+      if (it == stats.tables.end()) {
+        TableStats table;
+        table.table = counters->table;
+        table.generation = counters->generation;
+        table.hand_size = counters->hand_size;
+        table.rows = RowHistogram(counters->hand_size, counters->rows.size());
+        stats.tables.push_back(std::move(table));
+        cache_lines.emplace_back(counters->hand_size);
+        pages.emplace_back(counters->hand_size);
+        it = stats.tables.end() - 1;
+      }
+      size_t index = it - stats.tables.begin();
+
+      it->evaluations += evaluations;
+      for (size_t row = 0; row < counters->rows.size(); row++) {
+        if (uint64_t visits = counters->rows[row].load(std::memory_order_relaxed)) {
+          it->rows.add(row, visits);
+        }
+      }
+      for (uint32_t level = 0; level < counters->hand_size; level++) {
+        or_bits(counters->cache_lines[level], &cache_lines[index][level]);
+        or_bits(counters->pages[level], &pages[index][level]);
+      }
+      for (size_t bucket = 0; bucket < kLatencyBuckets; bucket++) {
+        it->latency_ns[bucket] += counters->latency_ns[bucket].load(std::memory_order_relaxed);
+      }
+      it->latency_samples += counters->latency_samples.load(std::memory_order_relaxed);
+    }
+    stats.threads.push_back(thread_stats);
+  }
+
+  auto count_bits = [](const std::vector<uint64_t>& bits) {
+    uint64_t count = 0;
+    for (uint64_t word : bits) {
+      count += __builtin_popcountll(word);
+    }
+    return count;
+  };
+  for (size_t index = 0; index < stats.tables.size(); index++) {
+    for (uint32_t level = 0; level < stats.tables[index].hand_size; level++) {
+      stats.tables[index].cache_lines.push_back(count_bits(cache_lines[index][level]));
+      stats.tables[index].pages.push_back(count_bits(pages[index][level]));
+    }
+  }
+  return stats;
+}
+
+inline void CountingInstrumentation::write_json(const Stats& stats, std::ostream& out) {
+  auto write_list = [&](const std::vector<uint64_t>& values) {
+    out << '[';
+    for (size_t i = 0; i < values.size(); i++) {
+      out << (i ? ", " : "") << values[i];
+    }
+    out << ']';
+  };
+
+  out << "{\n"
+      << "  \"pid\": " << getpid() << ",\n"
+      << "  \"latency_sample_period\": " << latency_sample_period() << ",\n"
+      << "  \"threads\": [";
+  for (size_t i = 0; i < stats.threads.size(); i++) {
+    out << (i ? ",\n" : "\n") << "    {\"tid\": " << stats.threads[i].tid
+        << ", \"evaluations\": " << stats.threads[i].evaluations << "}";
+  }
+  out << "\n  ],\n  \"tables\": [";
+  for (size_t i = 0; i < stats.tables.size(); i++) {
+    const TableStats& table = stats.tables[i];
+    uint64_t rows_visited = std::count_if(table.rows.counts().begin(), table.rows.counts().end(),
+                                          [](uint64_t visits) { return visits != 0; });
+    out << (i ? ",\n" : "\n") << "    {\n"
+        << "      \"table\": \"" << static_cast<const void*>(table.table) << "\",\n"
+        << "      \"generation\": " << table.generation << ",\n"
+        << "      \"hand_size\": " << table.hand_size << ",\n"
+        << "      \"evaluations\": " << table.evaluations << ",\n"
+        << "      \"rows\": " << table.rows.counts().size() << ",\n"
+        << "      \"rows_visited\": " << rows_visited << ",\n"
+        << "      \"cache_lines_per_level\": ";
+    write_list(table.cache_lines);
+    out << ",\n      \"pages_per_level\": ";
+    write_list(table.pages);
+    out << ",\n      \"latency_samples\": " << table.latency_samples << ",\n"
+        << "      \"latency_ns_log2_buckets\": ";
+    write_list(std::vector<uint64_t>(table.latency_ns.begin(), table.latency_ns.end()));
+    out << "\n    }";
+  }
+  out << "\n  ]\n}\n";
+}
+
+inline InstrumentationDumper::InstrumentationDumper(const std::string& path, int signal)
+    : path_(path), signal_(signal) {
+  if (pipe2(pipe_, O_CLOEXEC) != 0) {
+    details::throw_errno("pipe2");
+  }
+  // The handler must never block.
+  fcntl(pipe_[1], F_SETFL, fcntl(pipe_[1], F_GETFL) | O_NONBLOCK);
+
+  int expected = -1;
+  if (!write_fd().compare_exchange_strong(expected, pipe_[1])) {
+    close(pipe_[0]);
+    close(pipe_[1]);
+    throw std::logic_error("InstrumentationDumper: another dumper is active");
+  }
+
+  thread_ = std::thread([this]() {
+    for (;;) {
+      char command;
+      ssize_t n = read(pipe_[0], &command, 1);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n != 1 || command == 'q') {
+        break;
+      }
+      try {
+        dump();
+      } catch (const std::exception& e) {
+        std::fprintf(stderr, "InstrumentationDumper: %s\n", e.what());
+      }
+    }
+  });
+
+  struct sigaction action = {};
+  action.sa_handler = &InstrumentationDumper::on_signal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(signal_, &action, &previous_action_);
+}
+
+inline InstrumentationDumper::~InstrumentationDumper() {
+  sigaction(signal_, &previous_action_, nullptr);
+  write_fd().store(-1);
+  char quit = 'q';
+  while (write(pipe_[1], &quit, 1) != 1 && errno == EAGAIN) {
+    std::this_thread::yield();
+  }
+  thread_.join();
+  close(pipe_[0]);
+  close(pipe_[1]);
+}
+
+inline void InstrumentationDumper::on_signal(int) {
+  int saved_errno = errno;
+  int fd = write_fd().load();
+  if (fd >= 0) {
+    char command = 'd';
+    // A full pipe already has a dump pending.
+    ssize_t ignored = write(fd, &command, 1);
+    (void)ignored;
+  }
+  errno = saved_errno;
+}
+
+inline void InstrumentationDumper::dump() const {
+  auto stats = CountingInstrumentation::snapshot();
+  for (size_t i = 0; i < stats.tables.size(); i++) {
+    std::string hist_path = path_ + "." + std::to_string(i) + ".hist";
+    stats.tables[i].rows.save(hist_path + ".tmp");
+    if (std::rename((hist_path + ".tmp").c_str(), hist_path.c_str()) != 0) {
+      details::throw_errno("rename " + hist_path);
+    }
+  }
+
+  std::ofstream file(path_ + ".tmp");
+  CountingInstrumentation::write_json(stats, file);
+  file.close();
+  if (!file) {
+    throw std::runtime_error("write " + path_ + ".tmp failed");
+  }
+  if (std::rename((path_ + ".tmp").c_str(), path_.c_str()) != 0) {
+    details::throw_errno("rename " + path_);
+  }
+}
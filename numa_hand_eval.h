@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "poker_hand_eval.h"
+
+// One copy of a table per NUMA node.
+//
+// On multi-socket hosts, threads that walk a table allocated on another node
+// pay the interconnect latency on every hop. NumaPokerHandEval places one
+// replica on each node that has CPUs, and hands every worker thread the
+// replica of the node it runs on. Nodes are discovered through sysfs, so no
+// libnuma is needed; on a host without NUMA there is a single replica.
+//
+// Example usage:
+//   NumaPokerHandEval<7> numa("/path/to/bfs7.phe");
+//   // In each worker thread, once:
+//   const PokerHandEval<7>& phe = numa.local();
+//   ... phe.eval(...) ...
+//
+// local() pins the calling thread to the CPUs of its current node, so that
+// the scheduler cannot later migrate it away from its replica. To spread
+// workers over nodes explicitly instead, use bind_to_node(worker % num_nodes()).
+template <uint8_t hand_size>
+class NumaPokerHandEval {
+ public:
+  // Replicates the table at `path` onto every node. Of the load options, only
+  // huge_pages and lock apply to the replicas.
+  NumaPokerHandEval(const std::string& path);
+  NumaPokerHandEval(const std::string& path, const PheLoadOptions& options);
+  NumaPokerHandEval(const NumaPokerHandEval&) = delete;
+  NumaPokerHandEval(NumaPokerHandEval&&) = default;
+
+  // Number of replicas, one per NUMA node with CPUs.
+  size_t num_nodes() const { return nodes_.size(); }
+
+  // Kernel node ID of replica i.
+  int node_id(size_t i) const { return nodes_[i].id; }
+
+  // Returns the replica on the calling thread's current node, and pins the
+  // thread to that node's CPUs.
+  const PokerHandEval<hand_size>& local() const;
+
+  // Pins the calling thread to the CPUs of replica i's node, and returns
+  // that replica.
+  const PokerHandEval<hand_size>& bind_to_node(size_t i) const;
+
+  // Returns replica i, without touching thread placement.
+  const PokerHandEval<hand_size>& replica(size_t i) const { return *replicas_[i]; }
+
+ private:
+  struct Node {
+    int id;
+    std::vector<int> cpus;
+  };
+
+  std::vector<Node> nodes_;
+  std::vector<std::unique_ptr<PokerHandEval<hand_size>>> replicas_;
+};
+
+//////////////////////////////////
+// Implementation details below //
+//////////////////////////////////
+
+namespace details {
+
+// Parses a sysfs CPU list, such as "0-3,8,10-11".
+inline std::vector<int> parse_cpu_list(const std::string& list) {
+  std::vector<int> cpus;
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    std::string range = list.substr(pos, end - pos);
+    if (!range.empty() && range != "\n") {
+      size_t dash = range.find('-');
+      int first = std::stoi(range.substr(0, dash));
+      int last = (dash == std::string::npos ? first : std::stoi(range.substr(dash + 1)));
+      for (int cpu = first; cpu <= last; cpu++) {
+        cpus.push_back(cpu);
+      }
+    }
+    pos = end + 1;
+  }
+  return cpus;
+}
+
+// Returns the (node ID, CPUs) of every online NUMA node that has CPUs the
+// calling thread may run on, in increasing node order, listing only those
+// CPUs: under taskset or a container's cpuset, other CPUs cannot be pinned
+// to. Falls back to a single node 0 holding every allowed CPU.
+inline std::vector<std::pair<int, std::vector<int>>> numa_nodes() {
+  std::vector<std::pair<int, std::vector<int>>> nodes;
+
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    throw_errno("sched_getaffinity");
+  }
+
+  if (DIR* dir = opendir("/sys/devices/system/node")) {
+    while (dirent* entry = readdir(dir)) {
+      int id;
+      char tail;
+      if (std::sscanf(entry->d_name, "node%d%c", &id, &tail) != 1) {
+        continue;
+      }
+      std::ifstream file("/sys/devices/system/node/" + std::string(entry->d_name) + "/cpulist");
+      std::string list;
+      std::getline(file, list);
+      auto cpus = parse_cpu_list(list);
+      cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                                [&](int cpu) { return cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed); }),
+                 cpus.end());
+      if (!cpus.empty()) {
+        nodes.emplace_back(id, std::move(cpus));
+      }
+    }
+    closedir(dir);
+  }
+
+  if (nodes.empty()) {
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+    nodes.emplace_back(0, std::move(cpus));
+  }
+
+  std::sort(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+// Restricts the calling thread to the given CPUs.
+inline void pin_to_cpus(const std::vector<int>& cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    throw_errno("sched_setaffinity");
+  }
+}
+
+// Returns the NUMA node the calling thread is running on.
+inline int current_numa_node() {
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    return 0;
+  }
+  return node;
+}
+
+// Copies num_bytes from src into fresh memory on NUMA node `node`.
+//
+// The pages are bound to the node with mbind, and first touched by a thread
+// pinned to the node's CPUs, so they land on the node even where mbind is
+// unavailable (e.g. in restricted containers).
+inline std::shared_ptr<const void> replicate_on_node(const void* src,
+                                                     size_t num_bytes,
+                                                     int node,
+                                                     const std::vector<int>& cpus,
+                                                     const PheLoadOptions& options) {
+  // Pages are faulted in by the pinned thread below, not here.
+  PheLoadOptions map_options = options;
+  map_options.populate = false;
+  size_t map_bytes = 0;
+  auto owner = map_anonymous(num_bytes, "replica", map_options, &map_bytes);
+  void* addr = const_cast<void*>(owner.get());
+
+  // Best effort; first touch below does the rest.
+  std::vector<unsigned long> node_mask(node / (8 * sizeof(unsigned long)) + 1);
+  node_mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+  syscall(SYS_mbind, addr, map_bytes, MPOL_BIND, node_mask.data(), node_mask.size() * 8 * sizeof(unsigned long) + 1, 0);
+
+  std::exception_ptr error;
+  std::thread toucher([&]() {
+    try {
+      pin_to_cpus(cpus);
+      // Fault in every base page after MADV_HUGEPAGE, rather than in
+      // whatever order memcpy happens to write.
+      if (options.huge_pages == PheLoadOptions::HugePages::kTransparent) {
+        const size_t page_size = sysconf(_SC_PAGESIZE);
+        for (size_t offset = 0; offset < map_bytes; offset += page_size) {
+          static_cast<volatile char*>(addr)[offset] = 0;
+        }
+      }
+      std::memcpy(addr, src, num_bytes);
+    } catch (...) {
+      error = std::current_exception();
+    }
+  });
+  toucher.join();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  mprotect(addr, map_bytes, PROT_READ);
+  if (options.lock && mlock(addr, num_bytes) != 0) {
+    throw_errno("mlock replica");
+  }
+  return owner;
+}
+
+}  // namespace details
+
+template <uint8_t hand_size>
+NumaPokerHandEval<hand_size>::NumaPokerHandEval(const std::string& path)
+    : NumaPokerHandEval(path, PheLoadOptions()) {}
+
+template <uint8_t hand_size>
+NumaPokerHandEval<hand_size>::NumaPokerHandEval(const std::string& path, const PheLoadOptions& options) {
+  // Stage the file through the page cache; every replica is a private copy.
+  PheLoadOptions source_options;
+  source_options.mode = PheLoadOptions::Mode::kMmap;
+  size_t num_bytes = 0;
+  auto source = details::load_table(path, source_options, &num_bytes);
+
+  for (auto& node : details::numa_nodes()) {
+    auto storage = details::replicate_on_node(source.get(), num_bytes, node.first, node.second, options);
+    std::shared_ptr<const uint32_t> table(storage, static_cast<const uint32_t*>(storage.get()));
+    replicas_.push_back(std::make_unique<PokerHandEval<hand_size>>(std::move(table), num_bytes / sizeof(uint32_t)));
+    nodes_.push_back({node.first, std::move(node.second)});
+  }
+}
+
+template <uint8_t hand_size>
+const PokerHandEval<hand_size>& NumaPokerHandEval<hand_size>::local() const {
+  int id = details::current_numa_node();
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    if (nodes_[i].id == id) {
+      return bind_to_node(i);
+    }
+  }
+  // The thread runs on a node without a replica, e.g. one brought online
+  // after construction.
+  return bind_to_node(0);
+}
+
+template <uint8_t hand_size>
+const PokerHandEval<hand_size>& NumaPokerHandEval<hand_size>::bind_to_node(size_t i) const {
+  details::pin_to_cpus(nodes_[i].cpus);
+  return *replicas_[i];
+}
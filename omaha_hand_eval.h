@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "poker_hand_eval.h"
+
+// Omaha evaluator: the best hand made of exactly two hole cards and exactly
+// three of the five board cards, on a regular 5-card table
+// (tables/bfs5.phe).
+//
+// Evaluating Omaha with PokerHandEval<5> takes one 5-card walk per pair of
+// hole cards and triple of board cards: 60 walks, 300 loads, for four hole
+// cards. A 5-card table is order-independent, though, so the walks can be
+// split by alphabet and their common prefixes shared:
+//   1. The board is walked once into the states of its ten triples
+//      (5 + 10 + 10 loads, at most three deep).
+//   2. Each hole card takes one hop from every triple state (10 loads per
+//      card).
+//   3. Each hole pair takes the second hop from the first card's states, and
+//      the smallest of the ten scores wins (10 loads per pair).
+// Only board triples are ever combined with hole pairs, so the exactly-two /
+// exactly-three rule holds by construction. PLO4 needs 125 loads instead of
+// 300, PLO6 235 instead of 750, and every chain is at most five loads deep.
+// The whole 1.3 MiB table stays in L2.
+//
+// Example usage:
+//   OmahaHandEval phe("/path/to/bfs5.phe");
+//   std::array<int, 5> board{37, 0, 48, 26, 7};
+//   std::array<int, 4> hole{5, 8, 12, 51};
+//   auto score = phe.eval(board, hole);
+//
+// Any number of hole cards from 2 to 6 works, which covers PLO4, PLO5 and
+// PLO6.
+class OmahaHandEval {
+ public:
+  static constexpr size_t kMaxHoleCards = 6;
+
+  // Loads a 5-card table, raw or compressed.
+  OmahaHandEval(const std::string& path);
+  OmahaHandEval(const std::string& path, const PheLoadOptions& options);
+  OmahaHandEval(const OmahaHandEval&) = delete;
+  // The moved-from evaluator is left empty, with no table.
+  OmahaHandEval(OmahaHandEval&& other) noexcept;
+  OmahaHandEval& operator=(OmahaHandEval&& other) noexcept;
+
+  // Scores the 5 cards of `board` with the 2 to 6 cards of `hole`. Throws
+  // std::invalid_argument for any other number of cards.
+  template <typename Board, typename Hole>
+  uint32_t eval(const Board& board, const Hole& hole) const;
+
+  // Calls fn(hole, score) for every pair of hole cards not on `board`, where
+  // hole is a sorted std::array<uint32_t, 2>. The board is walked once.
+  // Throws std::invalid_argument unless the board has 5 cards.
+  template <typename Board, typename Fn>
+  void sweep(const Board& board, Fn fn) const;
+
+ private:
+  using Triples = std::array<uint32_t, 10>;
+
+  // Returns the table states of the ten triples of `board`, after checking
+  // that it has 5 cards.
+  template <typename Board>
+  Triples walk_board(const Board& board) const;
+
+  const uint32_t* table_ = nullptr;
+  std::shared_ptr<const void> storage_;
+};
+
+//////////////////////////////////
+// Implementation details below //
+//////////////////////////////////
+
+inline OmahaHandEval::OmahaHandEval(const std::string& path)
+    : OmahaHandEval(path, PheLoadOptions()) {}
+
+inline OmahaHandEval::OmahaHandEval(const std::string& path, const PheLoadOptions& options) {
+  size_t num_bytes = 0;
+  storage_ = details::load_table(path, options, &num_bytes, 5);
+  if (num_bytes == 0 || num_bytes % (52 * sizeof(uint32_t)) != 0) {
+    throw std::runtime_error(path + ": not a 5-card table");
+  }
+  table_ = static_cast<const uint32_t*>(storage_.get());
+}
+
+inline OmahaHandEval::OmahaHandEval(OmahaHandEval&& other) noexcept
+    : table_(std::exchange(other.table_, nullptr)), storage_(std::move(other.storage_)) {}
+
+inline OmahaHandEval& OmahaHandEval::operator=(OmahaHandEval&& other) noexcept {
+  if (this != &other) {
+    table_ = std::exchange(other.table_, nullptr);
+    storage_ = std::move(other.storage_);
+  }
+  return *this;
+}
+
+template <typename Board>
+OmahaHandEval::Triples OmahaHandEval::walk_board(const Board& board) const {
+  if (std::size(board) != 5) {
+    throw std::invalid_argument("OmahaHandEval: the board must have 5 cards");
+  }
+  uint32_t cards[5];
+  std::copy_n(std::begin(board), 5, cards);
+
+  uint32_t singles[5];
+  for (int i = 0; i < 5; i++) {
+    singles[i] = table_[cards[i]];
+  }
+  uint32_t pairs[10];
+  for (int i = 0, p = 0; i < 5; i++) {
+    for (int j = i + 1; j < 5; j++) {
+      pairs[p++] = table_[singles[i] + cards[j]];
+    }
+  }
+  Triples triples;
+  for (int i = 0, p = 0, t = 0; i < 5; i++) {
+    for (int j = i + 1; j < 5; j++, p++) {
+      for (int k = j + 1; k < 5; k++) {
+        triples[t++] = table_[pairs[p] + cards[k]];
+      }
+    }
+  }
+  return triples;
+}
+
+template <typename Board, typename Hole>
+uint32_t OmahaHandEval::eval(const Board& board, const Hole& hole) const {
+  const size_t num_hole = std::size(hole);
+  if (num_hole < 2 || num_hole > kMaxHoleCards) {
+    throw std::invalid_argument("OmahaHandEval: a hand needs 2 to 6 hole cards");
+  }
+  const Triples triples = walk_board(board);
+
+  // First hop of every hole card from every triple, shared by all pairs.
+  uint32_t cards[kMaxHoleCards];
+  uint32_t hop[kMaxHoleCards][10];
+  auto it = std::begin(hole);
+  for (size_t i = 0; i < num_hole; i++, ++it) {
+    cards[i] = *it;
+    for (int t = 0; t < 10; t++) {
+      hop[i][t] = table_[triples[t] + cards[i]];
+    }
+  }
+
+  uint32_t best = UINT32_MAX;
+  for (size_t i = 0; i + 1 < num_hole; i++) {
+    for (size_t j = i + 1; j < num_hole; j++) {
+      for (int t = 0; t < 10; t++) {
+        best = std::min(best, table_[hop[i][t] + cards[j]]);
+      }
+    }
+  }
+  return best;
+}
+
+template <typename Board, typename Fn>
+void OmahaHandEval::sweep(const Board& board, Fn fn) const {
+  const Triples triples = walk_board(board);
+
+  bool on_board[52] = {};
+  auto it = std::begin(board);
+  for (int i = 0; i < 5; i++, ++it) {
+    on_board[*it] = true;
+  }
+
+  std::array<uint32_t, 2> hole;
+  for (uint32_t first = 0; first < 52; first++) {
+    if (on_board[first]) {
+      continue;
+    }
+    hole[0] = first;
+    uint32_t hop[10];
+    for (int t = 0; t < 10; t++) {
+      hop[t] = table_[triples[t] + first];
+    }
+    for (uint32_t second = first + 1; second < 52; second++) {
+      if (on_board[second]) {
+        continue;
+      }
+      hole[1] = second;
+      uint32_t best = UINT32_MAX;
+      for (int t = 0; t < 10; t++) {
+        best = std::min(best, table_[hop[t] + second]);
+      }
+      fn(static_cast<const std::array<uint32_t, 2>&>(hole), best);
+    }
+  }
+}
@@ -2,11 +2,282 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PHE_HAVE_X86_SIMD 1
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Controls how a *.phe file is brought into memory.
+//
+// The default reads the file into a private heap buffer. Mapping the file
+// instead lets every process on the host share one copy of the table through
+// the page cache, and the remaining knobs remove page faults from the first
+// evaluations.
+//
+// Example usage:
+//   PheLoadOptions options;
+//   options.mode = PheLoadOptions::Mode::kMmap;
+//   options.populate = true;
+//   options.lock = true;
+//   PokerHandEval<7> phe("/path/to/table7.phe", options);
+struct PheLoadOptions {
+  enum class Mode {
+    // Read the file into a private, page-aligned buffer, so that the rows of
+    // a padded table (see RowPlacement) keep their alignment.
+    kRead,
+    // Map the file read-only. The pages are shared with every other process
+    // mapping the same file.
+    kMmap,
+  };
+
+  enum class HugePages {
+    kNone,
+    // Advise the kernel to back the table with transparent huge pages.
+    kTransparent,
+    // Copy the table into an explicitly reserved huge page region
+    // (see vm.nr_hugepages). This always yields a private copy; to share
+    // explicit huge pages between processes, place the file on hugetlbfs and
+    // use kMmap.
+    kExplicit,
+  };
+
+  Mode mode = Mode::kRead;
+  // Pre-fault every page of the table at load time (MAP_POPULATE, or by
+  // touching each page when transparent huge pages are requested).
+  bool populate = false;
+  // Pin the table in physical memory (mlock).
+  bool lock = false;
+  HugePages huge_pages = HugePages::kNone;
+  // Threads that decode a compressed table (*.phez); 0 uses every hardware
+  // thread. Ignored for raw tables.
+  size_t decode_threads = 0;
+};
+
+// On-disk layout of a compressed table (*.phez): this header, then one
+// PheCompressedChunk per chunk, then the encoded chunks.
+//
+// The table is cut into chunks of rows_per_chunk 52-slot rows, which decode
+// independently. Each row is packed on its own, in whichever of two forms is
+// smaller:
+//   * frame of reference: the row minimum, then 52 offsets from it;
+//   * dictionary: the distinct values of the row, packed the same way, then
+//     52 indices into them.
+// Rows of interior levels hold row offsets, which are multiples of 52 apart;
+// such rows store their offsets divided by 52.
+//
+// All files load as plain tables: PokerHandEval and the other evaluators
+// recognize the magic and decode in parallel into private memory.
+struct PheCompressedHeader {
+  static constexpr char kMagic[8] = {'P', 'H', 'E', 'Z', '\0', '\0', '\0', '\0'};
+  static constexpr uint32_t kVersion = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t hand_size;
+  // Layout of the rows, e.g. "bfs". Informational.
+  char layout[16];
+  // How cards map to slots; evaluators only accept "rank-major"
+  // (card = 4 * rank + suit).
+  char card_mapping[16];
+  // Meaning of the terminal values; evaluators only accept "cactus-kev"
+  // (1 is a royal flush, 7462 the worst high card).
+  char score_semantics[16];
+  // Number of uint32_t slots of the decoded table.
+  uint64_t num_entries;
+  uint32_t rows_per_chunk;
+  uint32_t num_chunks;
+  // Checksum of this header, with this field zeroed, and the chunk
+  // directory. Since the directory holds the checksum of every decoded
+  // chunk, it covers the whole table.
+  uint64_t checksum;
+};
+
+struct PheCompressedChunk {
+  // Byte offset of the encoded chunk from the start of the file.
+  uint64_t offset;
+  uint64_t num_bytes;
+  // Checksum of the decoded uint32_t slots of the chunk.
+  uint64_t checksum;
+};
+
+// Instruction sets available to the structure-of-arrays evaluator.
+enum class SimdIsa {
+  kScalar,
+  // 8 hands per gather (vpgatherdd ymm).
+  kAvx2,
+  // 16 hands per gather (vpgatherdd zmm).
+  kAvx512,
+};
+
+// Returns the widest instruction set supported by the running CPU.
+inline SimdIsa detect_simd_isa();
+
+// Result of PokerHandEval::equity, with one entry per player.
+struct EquityResult {
+  // Fraction of boards won outright.
+  std::vector<double> win;
+  // Fraction of boards on which the best hand is shared.
+  std::vector<double> tie;
+  // Expected share of the pot: wins, plus ties split among the tied players.
+  std::vector<double> equity;
+  // Number of boards enumerated.
+  uint64_t num_boards = 0;
+};
+
+// Visit counts of the rows of a table, recorded from a representative
+// workload with PokerHandEval::eval_recorded. The table generator turns a
+// histogram into a profile-guided memory layout, with the hottest rows packed
+// together at the front of the table (see profile_guided_memory_order).
+//
+// Row r holds table entries [52 * r, 52 * r + 52). Counts refer to the rows
+// of the table they were recorded on.
+//
+// Example usage:
+//   PokerHandEval<7> phe("/path/to/bfs7.phe");
+//   RowHistogram histogram(7, phe.num_rows());
+//   for (const auto& hand : workload) {
+//     phe.eval_recorded(hand, &histogram);
+//   }
+//   histogram.save("/path/to/bfs7.hist");
+//
+// Recording is not thread-safe; give each thread its own histogram and
+// merge them.
+class RowHistogram {
+ public:
+  RowHistogram(uint32_t hand_size, size_t num_rows) : hand_size_(hand_size), counts_(num_rows) {}
+
+  // Loads a histogram written by save().
+  explicit RowHistogram(const std::string& path);
+
+  void save(const std::string& path) const;
+
+  // Counts `count` visits of `row`.
+  void add(uint32_t row, uint64_t count = 1) { counts_[row] += count; }
+
+  // Adds the counts of another histogram of the same table.
+  void merge(const RowHistogram& other);
+
+  // Hand size of the table the histogram was recorded on.
+  uint32_t hand_size() const { return hand_size_; }
+
+  const std::vector<uint64_t>& counts() const { return counts_; }
+
+ private:
+  uint32_t hand_size_ = 0;
+  std::vector<uint64_t> counts_;
+};
+
+// On-disk layout of a histogram: this header, followed by num_rows uint64_t
+// visit counts.
+struct RowHistogramHeader {
+  static constexpr char kMagic[8] = {'P', 'H', 'E', 'H', 'I', 'S', 'T', '\0'};
+  static constexpr uint32_t kVersion = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t hand_size;
+  uint64_t num_rows;
+};
+
+namespace details {
+
+// Numbers instrumented evaluators in order of construction, from 1.
+inline uint64_t next_evaluator_generation() {
+  static std::atomic<uint64_t> generation{0};
+  return generation.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+}  // namespace details
+
+// Instrumentation policy of PokerHandEval that records nothing: eval compiles
+// to the plain table walk.
+//
+// A recording policy is a type with
+//   static constexpr bool kEnabled = true;
+// and a nested Probe type, constructed at the start of every eval:
+//   // generation is unique to the evaluator (and its moved-to successors),
+//   // so that a table later loaded at the same address can be told apart.
+//   Probe(const uint32_t* table, size_t table_size, uint32_t hand_size, uint64_t generation);
+//   // Called before each load, with the number of cards consumed so far and
+//   // the offset of the loaded slot.
+//   void visit(uint32_t level, uint32_t offset);
+//   // Called once the score is known.
+//   void finish();
+// See CountingInstrumentation in instrumentation.h.
+struct NoInstrumentation {
+  static constexpr bool kEnabled = false;
+};
+
+template <uint8_t hand_size, typename Instrumentation = NoInstrumentation>
+class PokerHandEval;
+
+// A partially dealt hand: the finite-state-machine state after `depth` cards.
+//
+// The FSM accepts cards in any order, so a shared prefix (e.g. a board) can be
+// walked once and each completion finished off a copy of the state. States are
+// trivially copyable and hold a pointer into the evaluator's table, which must
+// outlive them. The number of cards consumed is tracked at compile time:
+// score() only exists for complete hands, and appending past hand_size cards
+// does not compile.
+//
+// Example usage:
+//   auto board = phe.start().append(37, 0, 48, 26, 7);
+//   for (auto& hole : holes) {
+//     uint32_t score = board.append(hole[0], hole[1]).score();
+//   }
+template <uint8_t hand_size, uint8_t depth = 0>
+class EvalState {
+ public:
+  static_assert(depth <= hand_size, "Too many cards for the hand size.");
+
+  // Returns the state after also consuming `card`.
+  template <typename CardType>
+  EvalState<hand_size, depth + 1> append(CardType card) const;
+
+  // Returns the state after also consuming all of `cards`, in order.
+  template <typename CardType, typename... Tail>
+  EvalState<hand_size, depth + 1 + sizeof...(Tail)> append(CardType card, Tail... rest) const;
+
+  // Returns the score of the completed hand.
+  uint32_t score() const;
+
+  // Returns the raw table offset of this state. For complete hands, this is
+  // the score.
+  uint32_t state() const { return state_; }
+
+ private:
+  template <uint8_t, uint8_t>
+  friend class EvalState;
+  template <uint8_t, typename>
+  friend class PokerHandEval;
+
+  EvalState(const uint32_t* table, uint32_t state) : table_(table), state_(state) {}
+
+  const uint32_t* table_;
+  uint32_t state_;
+};
+
 // Main class for evaluating poker hands.
 //
 // Example usage:
@@ -17,12 +288,30 @@
 //   std::vector<int> hand1{37, 0, 48, 26, 7, 5, 8};
 //   std::array<uint32_t, 7> hand2{37, 0, 48, 26, 7, 5, 8};
 //   phe.eval(hand1) == phe.eval(hand2);
-template <uint8_t hand_size>
+//
+// Many independent hands are best evaluated together, which overlaps the
+// memory latency of their table walks:
+//   std::vector<std::array<uint8_t, 7>> hands = ...;
+//   std::vector<uint32_t> scores(hands.size());
+//   phe.eval_batch(hands, &scores);
+//
+// The Instrumentation policy observes every eval (see NoInstrumentation); the
+// other entry points are never instrumented.
+template <uint8_t hand_size, typename Instrumentation>
 class PokerHandEval {
  public:
   PokerHandEval(const std::string& path);
+  PokerHandEval(const std::string& path, const PheLoadOptions& options);
+  // Wraps a table that is already in memory, with table_size uint32_t
+  // entries. The evaluator shares ownership of the table.
+  PokerHandEval(std::shared_ptr<const uint32_t> table, size_t table_size);
+  // Wraps a table that outlives the evaluator, such as one linked into the
+  // binary (see embedded_table.h). Nothing is read or copied.
+  PokerHandEval(const uint32_t* table, size_t table_size);
   PokerHandEval(const PokerHandEval&) = delete;
-  PokerHandEval(PokerHandEval&&) = default;
+  // The moved-from evaluator is left empty, with no table.
+  PokerHandEval(PokerHandEval&& other) noexcept;
+  PokerHandEval& operator=(PokerHandEval&& other) noexcept;
 
   template <typename... CardType>
   uint32_t eval(CardType... hand) const;
@@ -30,14 +319,161 @@ class PokerHandEval {
   template <typename Container>
   uint32_t eval(const Container& hand) const;
 
+  // Returns the state of an empty hand, for incremental evaluation.
+  EvalState<hand_size> start() const;
+
+  // Number of 52-entry rows in the table. Only meaningful for tables whose
+  // rows are packed back to back, as are eval_recorded's histograms.
+  size_t num_rows() const { return table_size_ / 52; }
+
+  // As eval, but also counts every row the walk visits in *histogram, which
+  // must have num_rows() rows. The walk takes the same path as eval.
+  template <typename Container>
+  uint32_t eval_recorded(const Container& hand, RowHistogram* histogram) const;
+
+  // Evaluates n hands, writing the scores to out[0..n).
+  // Each hand is any random-access container of hand_size cards.
+  template <typename Hand>
+  void eval_batch(const Hand* in, uint32_t* out, size_t n) const;
+
+  // Evaluates every hand in `hands` into the matching slot of `scores`, which
+  // must be at least as large.
+  template <typename HandContainer, typename ScoreContainer>
+  void eval_batch(const HandContainer& hands, ScoreContainer* scores) const;
+
+  // Structure-of-arrays evaluation: cards[i][j] is the i-th card of the j-th
+  // hand, and its score is written to out[j], for j in [0, n).
+  // Uses gather instructions when the CPU supports them.
+  void eval_soa(const std::array<const uint32_t*, hand_size>& cards,
+                uint32_t* out,
+                size_t n) const;
+
+  // As above, but forces a particular kernel. The CPU must support `isa`.
+  void eval_soa(const std::array<const uint32_t*, hand_size>& cards,
+                uint32_t* out,
+                size_t n,
+                SimdIsa isa) const;
+
+  // As above, with each card lane held in a vector of equal length.
+  std::vector<uint32_t> eval_soa(
+      const std::array<std::vector<uint32_t>, hand_size>& cards) const;
+
   template <typename Fn>
   void sweep(Fn fn) const;
 
+  // Calls fn(hand, score) for every hand that starts with `prefix`. Throws
+  // std::invalid_argument if the prefix has more than hand_size cards, or a
+  // repeated or out-of-range card.
   template <typename Container, typename Fn>
   void sweep(const Container& prefix, Fn fn) const;
 
+  // Block-oriented sweep over every hand, one table row at a time.
+  //
+  // Calls fn(partial, scores, valid_cards) once per set of hand_size - 1
+  // cards, with partial the std::array of those cards and scores the table
+  // row they lead to: for every card whose bit is set in valid_cards (a
+  // uint64_t), scores[card] is the score of partial plus card. Each hand is
+  // covered by exactly one block, so per-hand work such as histogramming or
+  // min/max becomes a loop over contiguous slots, without a call per hand.
+  //
+  // Example usage:
+  //   std::vector<uint64_t> histogram(7463);
+  //   phe.sweep_blocks([&](const auto&, const uint32_t* scores, uint64_t valid_cards) {
+  //     for (; valid_cards; valid_cards &= valid_cards - 1) {
+  //       histogram[scores[__builtin_ctzll(valid_cards)]]++;
+  //     }
+  //   });
+  template <typename Fn>
+  void sweep_blocks(Fn fn) const;
+
+  // As above, restricted to hands that start with `prefix`, which must hold
+  // fewer than hand_size cards, none repeated. partial starts with the
+  // prefix. Throws std::invalid_argument otherwise.
+  template <typename Container, typename Fn>
+  void sweep_blocks(const Container& prefix, Fn fn) const;
+
+  // Multi-threaded sweep over every hand.
+  //
+  // The hand space is split into subtrees by their leading cards, which are
+  // scheduled on a work-stealing pool of num_threads workers (0 means one per
+  // hardware thread). Every worker owns an accumulator, initialized to a copy
+  // of `init`, and calls fn(&accumulator, hand, score) for each hand it
+  // visits. The partial accumulators are then combined, in worker order, with
+  // merge(&total, partial).
+  //
+  // Example usage:
+  //   auto histogram = phe.parallel_sweep(
+  //       std::vector<uint64_t>(7463),
+  //       [](auto* h, const auto&, uint32_t score) { (*h)[score]++; },
+  //       [](auto* total, const auto& h) {
+  //         for (size_t i = 0; i < h.size(); i++) (*total)[i] += h[i];
+  //       });
+  template <typename Accumulator, typename Fn, typename Merge>
+  Accumulator parallel_sweep(const Accumulator& init,
+                             Fn fn,
+                             Merge merge,
+                             size_t num_threads = 0) const;
+
+  // As above, restricted to hands that start with `prefix` and do not contain
+  // any of `dead_cards`. Throws std::invalid_argument if the prefix has more
+  // than hand_size cards or a repeated card, or if any card is out of range.
+  template <typename Container, typename DeadContainer, typename Accumulator, typename Fn, typename Merge>
+  Accumulator parallel_sweep(const Container& prefix,
+                             const DeadContainer& dead_cards,
+                             const Accumulator& init,
+                             Fn fn,
+                             Merge merge,
+                             size_t num_threads = 0) const;
+
+  // Multi-threaded sweep_blocks, scheduled as parallel_sweep; calls
+  // fn(&accumulator, partial, scores, valid_cards) for every block of hands
+  // that start with `prefix` and avoid `dead_cards`.
+  template <typename Container, typename DeadContainer, typename Accumulator, typename Fn, typename Merge>
+  Accumulator parallel_sweep_blocks(const Container& prefix,
+                                    const DeadContainer& dead_cards,
+                                    const Accumulator& init,
+                                    Fn fn,
+                                    Merge merge,
+                                    size_t num_threads = 0) const;
+
+  // Exact all-in equity of each player's two hole cards.
+  //
+  // Every completion of the board (to hand_size - 2 cards) that avoids the
+  // hole cards and `dead_cards` is enumerated once. Each board is walked once
+  // and every player's hand is finished off the shared board state with two
+  // loads. Work is spread over num_threads threads, as in parallel_sweep.
+  //
+  // Example usage:
+  //   std::vector<std::array<int, 2>> holes = {{48, 49}, {44, 40}};
+  //   auto result = phe.equity(holes, std::vector<int>{}, std::vector<int>{});
+  //   // result.equity[0] is the pot share of AcAd against Kc Qc.
+  template <typename HoleCards, typename BoardContainer, typename DeadContainer>
+  EquityResult equity(const std::vector<HoleCards>& hole_cards,
+                      const BoardContainer& board_prefix,
+                      const DeadContainer& dead_cards,
+                      size_t num_threads = 1) const;
+
  private:
-  std::vector<uint32_t> table_;
+  // Implements parallel_sweep for hands of `depth` cards, passing the state
+  // after those cards (the score, if depth == hand_size) to fn.
+  template <uint8_t depth, typename Container, typename DeadContainer, typename Accumulator, typename Fn, typename Merge>
+  Accumulator parallel_sweep_to(const Container& prefix,
+                                const DeadContainer& dead_cards,
+                                const Accumulator& init,
+                                Fn fn,
+                                Merge merge,
+                                size_t num_threads) const;
+
+  // eval, reporting every load to an Instrumentation::Probe.
+  template <typename Iterator>
+  uint32_t eval_instrumented(Iterator it) const;
+
+  const uint32_t* table_ = nullptr;
+  size_t table_size_ = 0;
+  // Keeps the memory behind table_ alive (heap buffer or mapping).
+  std::shared_ptr<const void> storage_;
+  // Passed to every Instrumentation::Probe.
+  uint64_t generation_ = Instrumentation::kEnabled ? details::next_evaluator_generation() : 0;
 };
 
 //////////////////////////////////
@@ -51,12 +487,12 @@ struct EvalHelper;
 
 template <>
 struct EvalHelper<0> {
-  static constexpr uint32_t eval_cards(const std::vector<uint32_t>&) {
+  static constexpr uint32_t eval_cards(const uint32_t*) {
     return 0;
   }
 
   template <typename Iterator>
-  static constexpr uint32_t eval_iterator(const std::vector<uint32_t>&, Iterator) {
+  static constexpr uint32_t eval_iterator(const uint32_t*, Iterator) {
     return 0;
   }
 };
@@ -64,7 +500,7 @@ struct EvalHelper<0> {
 template <uint8_t hand_size>
 struct EvalHelper {
   template <typename CardType, typename... Tail>
-  static constexpr uint32_t eval_cards(const std::vector<uint32_t>& table,
+  static constexpr uint32_t eval_cards(const uint32_t* table,
                                        CardType first,
                                        Tail... rest) {
     static_assert(sizeof...(rest) + 1 == hand_size, "Wrong number of arguments.");
@@ -72,7 +508,7 @@ struct EvalHelper {
   }
 
   template <typename Iterator>
-  static constexpr uint32_t eval_iterator(const std::vector<uint32_t>& table,
+  static constexpr uint32_t eval_iterator(const uint32_t* table,
                                           Iterator it) {
     return table[*it + EvalHelper<hand_size - 1>::eval_iterator(table, std::next(it))];
   }
@@ -80,35 +516,973 @@ struct EvalHelper {
 
 }  // namespace details
 
-template <uint8_t hand_size>
-PokerHandEval<hand_size>::PokerHandEval(const std::string& path) {
-  std::ifstream file(path, std::ios::in | std::ifstream::binary);
+namespace details {
+
+constexpr size_t kHugePageSize = size_t{2} << 20;
+
+[[noreturn]] inline void throw_errno(const std::string& what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+inline std::shared_ptr<const void> make_mapping_owner(void* addr, size_t num_bytes) {
+  return std::shared_ptr<const void>(addr, [num_bytes](const void* p) {
+    munmap(const_cast<void*>(p), num_bytes);
+  });
+}
+
+// Reserves num_bytes of address space that start on a kHugePageSize
+// boundary, for a table to be mapped over with MAP_FIXED. Transparent huge
+// pages can then back the table from its first row, which layouts clustered
+// into 2 MiB pages (see RowPlacement) count on: the kernel only aligns large
+// anonymous mappings on some versions, and file mappings never.
+inline void* reserve_huge_page_aligned(size_t num_bytes, const std::string& path) {
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  num_bytes = (num_bytes + page_size - 1) / page_size * page_size;
+  const size_t reserve_bytes = num_bytes + kHugePageSize;
+  void* addr = mmap(nullptr, reserve_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (addr == MAP_FAILED) {
+    throw_errno("mmap " + path);
+  }
+  char* begin = static_cast<char*>(addr);
+  char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(begin) + kHugePageSize - 1) &
+                                          ~(uintptr_t{kHugePageSize} - 1));
+  if (aligned != begin) {
+    munmap(begin, aligned - begin);
+  }
+  munmap(aligned + num_bytes, begin + reserve_bytes - (aligned + num_bytes));
+  return aligned;
+}
+
+// Creates a private, writable anonymous mapping of at least num_bytes,
+// honoring the huge page and pre-fault options. Sets *map_bytes to the size
+// actually mapped. With huge pages, the mapping starts on a huge page
+// boundary.
+inline std::shared_ptr<const void> map_anonymous(size_t num_bytes,
+                                                 const std::string& path,
+                                                 const PheLoadOptions& options,
+                                                 size_t* map_bytes) {
+  using HugePages = PheLoadOptions::HugePages;
+
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  *map_bytes = num_bytes;
+  if (options.huge_pages != HugePages::kNone) {
+    *map_bytes = (num_bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  }
+  if (options.huge_pages == HugePages::kExplicit) {
+    flags |= MAP_HUGETLB;
+  }
+  // MAP_POPULATE would fault in 4 KiB pages before MADV_HUGEPAGE is given;
+  // transparent huge pages are pre-faulted by hand below instead.
+  if (options.populate && options.huge_pages != HugePages::kTransparent) {
+    flags |= MAP_POPULATE;
+  }
+
+  // MAP_HUGETLB mappings are aligned already.
+  void* hint = nullptr;
+  if (options.huge_pages == HugePages::kTransparent) {
+    hint = reserve_huge_page_aligned(*map_bytes, path);
+    flags |= MAP_FIXED;
+  }
+  void* addr = mmap(hint, *map_bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (addr == MAP_FAILED) {
+    int saved_errno = errno;
+    if (hint != nullptr) {
+      munmap(hint, *map_bytes);
+    }
+    errno = saved_errno;
+    throw_errno("mmap " + path);
+  }
+  auto owner = make_mapping_owner(addr, *map_bytes);
 
-  file.seekg(0, std::ios::end);
-  auto num_bytes = file.tellg();
-  file.seekg(0, std::ios::beg);
+  if (options.huge_pages == HugePages::kTransparent) {
+    madvise(addr, *map_bytes, MADV_HUGEPAGE);
+    // Every base page is touched, in case huge pages are not available.
+    if (options.populate) {
+      const size_t page_size = sysconf(_SC_PAGESIZE);
+      for (size_t offset = 0; offset < *map_bytes; offset += page_size) {
+        static_cast<volatile char*>(addr)[offset] = 0;
+      }
+    }
+  }
+  return owner;
+}
 
-  table_.resize(num_bytes / sizeof(uint32_t));
+inline void pread_all(int fd, void* out, size_t num_bytes, size_t offset, const std::string& path) {
+  for (size_t done = 0; done < num_bytes;) {
+    ssize_t n = pread(fd, static_cast<char*>(out) + done, num_bytes - done, offset + done);
+    if (n <= 0) {
+      throw_errno("read " + path);
+    }
+    done += n;
+  }
+}
 
-  file.read(reinterpret_cast<char*>(table_.data()), num_bytes);
-  file.close();
+// Reads the whole file into a fresh anonymous mapping, honoring the huge page
+// and pre-fault options.
+inline std::shared_ptr<const void> read_into_anonymous(int fd,
+                                                       size_t num_bytes,
+                                                       const std::string& path,
+                                                       const PheLoadOptions& options) {
+  size_t map_bytes = 0;
+  auto owner = map_anonymous(num_bytes, path, options, &map_bytes);
+  void* addr = const_cast<void*>(owner.get());
+  pread_all(fd, addr, num_bytes, 0, path);
+  mprotect(addr, map_bytes, PROT_READ);
+  return owner;
 }
 
+// Maps the file read-only, so that all processes share the page cache copy.
+inline std::shared_ptr<const void> map_file(int fd,
+                                            size_t num_bytes,
+                                            const std::string& path,
+                                            const PheLoadOptions& options) {
+  int flags = MAP_SHARED;
+  if (options.populate) {
+    flags |= MAP_POPULATE;
+  }
+  void* hint = nullptr;
+  if (options.huge_pages == PheLoadOptions::HugePages::kTransparent) {
+    hint = reserve_huge_page_aligned(num_bytes, path);
+    flags |= MAP_FIXED;
+  }
+
+  void* addr = mmap(hint, num_bytes, PROT_READ, flags, fd, 0);
+  if (addr == MAP_FAILED) {
+    int saved_errno = errno;
+    if (hint != nullptr) {
+      munmap(hint, num_bytes);
+    }
+    errno = saved_errno;
+    throw_errno("mmap " + path);
+  }
+  auto owner = make_mapping_owner(addr, num_bytes);
+
+  if (options.huge_pages == PheLoadOptions::HugePages::kTransparent) {
+    // Only honored for file mappings on kernels built with
+    // CONFIG_READ_ONLY_THP_FOR_FS; harmless otherwise.
+    madvise(addr, num_bytes, MADV_HUGEPAGE);
+  }
+  return owner;
+}
+
+// Decodes a compressed table (see PheCompressedHeader) into private memory.
+// Defined below run_work_stealing.
+inline std::shared_ptr<const void> load_compressed_table(int fd,
+                                                         size_t file_bytes,
+                                                         const std::string& path,
+                                                         const PheLoadOptions& options,
+                                                         uint32_t expected_hand_size,
+                                                         size_t* num_bytes);
+
+// Whether the file starts with the magic of a compressed table.
+inline bool is_compressed_table(int fd, size_t file_bytes) {
+  char magic[sizeof(PheCompressedHeader::kMagic)];
+  return file_bytes >= sizeof(PheCompressedHeader) &&
+         pread(fd, magic, sizeof(magic), 0) == static_cast<ssize_t>(sizeof(magic)) &&
+         std::memcmp(magic, PheCompressedHeader::kMagic, sizeof(magic)) == 0;
+}
+
+inline bool is_compressed_table(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  bool compressed = fstat(fd, &st) == 0 && is_compressed_table(fd, st.st_size);
+  close(fd);
+  return compressed;
+}
+
+// Loads the file at `path` as raw bytes. Compressed tables are decoded
+// transparently; if expected_hand_size is nonzero, they must be for that hand
+// size.
+inline std::shared_ptr<const void> load_table(const std::string& path,
+                                              const PheLoadOptions& options,
+                                              size_t* num_bytes,
+                                              uint32_t expected_hand_size = 0) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw_errno("open " + path);
+  }
+  std::shared_ptr<int> fd_closer(&fd, [](int* p) { close(*p); });
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    throw_errno("stat " + path);
+  }
+  *num_bytes = st.st_size;
+
+  std::shared_ptr<const void> storage;
+  if (is_compressed_table(fd, *num_bytes)) {
+    storage = load_compressed_table(fd, *num_bytes, path, options, expected_hand_size, num_bytes);
+  } else if (options.mode == PheLoadOptions::Mode::kMmap &&
+      options.huge_pages != PheLoadOptions::HugePages::kExplicit) {
+    storage = map_file(fd, *num_bytes, path, options);
+  } else {
+    storage = read_into_anonymous(fd, *num_bytes, path, options);
+  }
+
+  if (options.lock && mlock(storage.get(), *num_bytes) != 0) {
+    throw_errno("mlock " + path);
+  }
+  return storage;
+}
+
+// Number of independent walks eval_batch keeps in flight.
+constexpr size_t kBatchLanes = 16;
+
+// Walks up to kBatchLanes hands in lockstep, one FSM level at a time.
+// The loads of one level are independent across lanes, so their latencies
+// overlap, and each lane prefetches the row it will read at the next level.
+template <uint8_t hand_size, typename Hand>
+inline void eval_lanes(const uint32_t* table,
+                       const Hand* in,
+                       uint32_t* out,
+                       size_t num_lanes) {
+  uint32_t index[kBatchLanes];
+  for (size_t lane = 0; lane < num_lanes; lane++) {
+    index[lane] = std::begin(in[lane])[0];
+  }
+  for (uint8_t card_idx = 1; card_idx < hand_size; card_idx++) {
+    for (size_t lane = 0; lane < num_lanes; lane++) {
+      index[lane] = table[index[lane]] + std::begin(in[lane])[card_idx];
+      __builtin_prefetch(table + index[lane]);
+    }
+  }
+  for (size_t lane = 0; lane < num_lanes; lane++) {
+    out[lane] = table[index[lane]];
+  }
+}
+
+// Scalar structure-of-arrays kernel, using the same lockstep walk as
+// eval_lanes.
 template <uint8_t hand_size>
-template <typename... CardType>
-uint32_t PokerHandEval<hand_size>::eval(CardType... hand) const {
-  return details::EvalHelper<hand_size>::eval_cards(table_, hand...);
+inline void eval_soa_scalar(const uint32_t* table,
+                            const uint32_t* const* cards,
+                            uint32_t* out,
+                            size_t n) {
+  for (size_t i = 0; i < n; i += kBatchLanes) {
+    size_t num_lanes = std::min(kBatchLanes, n - i);
+    uint32_t index[kBatchLanes];
+    for (size_t lane = 0; lane < num_lanes; lane++) {
+      index[lane] = cards[0][i + lane];
+    }
+    for (uint8_t card_idx = 1; card_idx < hand_size; card_idx++) {
+      for (size_t lane = 0; lane < num_lanes; lane++) {
+        index[lane] = table[index[lane]] + cards[card_idx][i + lane];
+      }
+    }
+    for (size_t lane = 0; lane < num_lanes; lane++) {
+      out[i + lane] = table[index[lane]];
+    }
+  }
 }
 
+#ifdef PHE_HAVE_X86_SIMD
+
+// Each FSM level is one gather: index = table[index] + card, for 8 hands at a
+// time.
 template <uint8_t hand_size>
-template <typename Container>
-uint32_t PokerHandEval<hand_size>::eval(const Container& hand) const {
-  return details::EvalHelper<hand_size>::eval_iterator(table_, std::begin(hand));
+__attribute__((target("avx2"))) void eval_soa_avx2(const uint32_t* table,
+                                                   const uint32_t* const* cards,
+                                                   uint32_t* out,
+                                                   size_t n) {
+  const int* base = reinterpret_cast<const int*>(table);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cards[0] + i));
+    for (uint8_t card_idx = 1; card_idx < hand_size; card_idx++) {
+      __m256i card = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cards[card_idx] + i));
+      index = _mm256_add_epi32(_mm256_i32gather_epi32(base, index, 4), card);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_i32gather_epi32(base, index, 4));
+  }
+  if (i < n) {
+    const uint32_t* tail[hand_size];
+    for (uint8_t card_idx = 0; card_idx < hand_size; card_idx++) {
+      tail[card_idx] = cards[card_idx] + i;
+    }
+    eval_soa_scalar<hand_size>(table, tail, out + i, n - i);
+  }
 }
 
+// As eval_soa_avx2, for 16 hands at a time.
 template <uint8_t hand_size>
+__attribute__((target("avx512f"))) void eval_soa_avx512(const uint32_t* table,
+                                                        const uint32_t* const* cards,
+                                                        uint32_t* out,
+                                                        size_t n) {
+  // The masked form avoids a spurious -Wmaybe-uninitialized in some GCCs.
+  const __m512i zero = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i index = _mm512_loadu_si512(cards[0] + i);
+    for (uint8_t card_idx = 1; card_idx < hand_size; card_idx++) {
+      __m512i card = _mm512_loadu_si512(cards[card_idx] + i);
+      index = _mm512_add_epi32(_mm512_mask_i32gather_epi32(zero, 0xFFFF, index, table, 4), card);
+    }
+    _mm512_storeu_si512(out + i, _mm512_mask_i32gather_epi32(zero, 0xFFFF, index, table, 4));
+  }
+  if (i < n) {
+    const uint32_t* tail[hand_size];
+    for (uint8_t card_idx = 0; card_idx < hand_size; card_idx++) {
+      tail[card_idx] = cards[card_idx] + i;
+    }
+    eval_soa_scalar<hand_size>(table, tail, out + i, n - i);
+  }
+}
+
+#endif  // PHE_HAVE_X86_SIMD
+
+// Enumerates every way of filling hand[start, depth) with increasing cards
+// taken from deck[deck_begin, deck_size), walking the table along the way.
+// stack[i] is the state after hand[0, i), and stack[start] must already be
+// set. Calls fn(hand, stack[depth]) for each completed hand.
+template <uint8_t depth, typename Hand, typename Fn>
+inline void sweep_deck(const uint32_t* table,
+                       Hand& hand,
+                       uint32_t* stack,
+                       uint32_t start,
+                       const uint32_t* deck,
+                       uint32_t deck_begin,
+                       uint32_t deck_size,
+                       Fn& fn) {
+  if (deck_size < deck_begin + (depth - start)) {
+    return;
+  }
+
+  // Position of each hand card within the deck.
+  uint32_t pos[depth + 1];
+
+  // Create first legal hand.
+  for (uint32_t hand_idx = start; hand_idx < depth; hand_idx++) {
+    pos[hand_idx] = deck_begin + hand_idx - start;
+    hand[hand_idx] = deck[pos[hand_idx]];
+    stack[hand_idx + 1] = table[stack[hand_idx] + hand[hand_idx]];
+  }
+  fn(hand, stack[depth]);
+
+  // Generate all remaining hands.
+  while (true) {
+    int32_t start_idx = depth - 1;
+    while (start_idx >= static_cast<int32_t>(start) &&
+           pos[start_idx] >= deck_size - (depth - start_idx)) {
+      start_idx--;
+    }
+    if (start_idx < static_cast<int32_t>(start)) {
+      return;
+    }
+
+    // Advance the pivot and refill the tail with the smallest possible cards.
+    for (uint32_t hand_idx = start_idx, deck_idx = pos[start_idx] + 1; hand_idx < depth; hand_idx++, deck_idx++) {
+      pos[hand_idx] = deck_idx;
+      hand[hand_idx] = deck[deck_idx];
+      stack[hand_idx + 1] = table[stack[hand_idx] + hand[hand_idx]];
+    }
+    fn(hand, stack[depth]);
+  }
+}
+
+// Cards of `free_cards` that can complete a block whose free cards were
+// enumerated up to last_free_card (-1 if none were): sweeps deal cards in
+// increasing order, so only higher ones remain.
+inline uint64_t block_valid_cards(uint64_t free_cards, int32_t last_free_card) {
+  return last_free_card < 0 ? free_cards : free_cards & (~uint64_t{0} << (last_free_card + 1));
+}
+
+// Runs task_fn(worker, task) for every task in [0, num_tasks) on num_workers
+// threads.
+//
+// Tasks are expected to be ordered roughly from largest to smallest, and are
+// dealt round-robin into per-worker deques, each with its largest task at the
+// back. A worker drains its own deque from the back, largest first, and once
+// empty steals from the front of the others, i.e. their smallest remaining
+// tasks. Large tasks thus start early on their owners, and the tail of the
+// run is made of small stolen tasks that even out the workers' finish times.
+template <typename TaskFn>
+void run_work_stealing(size_t num_tasks, size_t num_workers, TaskFn task_fn) {
+  struct alignas(64) WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  std::vector<WorkQueue> queues(num_workers);
+  // Pushed to the front, so that the back holds the largest tasks.
+  for (size_t task = 0; task < num_tasks; task++) {
+    queues[task % num_workers].tasks.push_front(task);
+  }
+
+  auto next_task = [&](size_t worker, size_t* task) {
+    {
+      std::lock_guard<std::mutex> lock(queues[worker].mutex);
+      if (!queues[worker].tasks.empty()) {
+        *task = queues[worker].tasks.back();
+        queues[worker].tasks.pop_back();
+        return true;
+      }
+    }
+    for (size_t i = 1; i < num_workers; i++) {
+      WorkQueue& victim = queues[(worker + i) % num_workers];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        *task = victim.tasks.front();
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  };
+
+  auto work = [&](size_t worker) {
+    size_t task;
+    while (next_task(worker, &task)) {
+      task_fn(worker, task);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t worker = 1; worker < num_workers; worker++) {
+    threads.emplace_back(work, worker);
+  }
+  work(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// An all-in can hold at most 23 two-card hands.
+constexpr size_t kMaxEquityPlayers = 23;
+
+// Tallies the outcome of all-in boards, for PokerHandEval::equity and the
+// Monte Carlo estimator.
+//
+// Ties are tallied in fixed-point units divisible by every possible number of
+// tied players, so that the totals are exact regardless of how the boards
+// were split between threads.
+class EquityTally {
+ public:
+  static constexpr uint64_t kShareUnit = 5354228880ull;  // lcm(1, ..., 23)
+
+  explicit EquityTally(size_t num_players)
+      : wins_(num_players), ties_(num_players), shares_(num_players) {}
+
+  // Records one board, given each player's score. Lower scores win.
+  void add(const uint32_t* scores) {
+    const size_t num_players = wins_.size();
+    uint32_t best = UINT32_MAX;
+    uint32_t num_best = 0;
+    for (size_t p = 0; p < num_players; p++) {
+      if (scores[p] < best) {
+        best = scores[p];
+        num_best = 1;
+      } else if (scores[p] == best) {
+        num_best++;
+      }
+    }
+    for (size_t p = 0; p < num_players; p++) {
+      if (scores[p] == best) {
+        (num_best == 1 ? wins_ : ties_)[p]++;
+        shares_[p] += kShareUnit / num_best;
+      }
+    }
+    num_boards_++;
+  }
+
+  void merge(const EquityTally& other) {
+    for (size_t p = 0; p < wins_.size(); p++) {
+      wins_[p] += other.wins_[p];
+      ties_[p] += other.ties_[p];
+      shares_[p] += other.shares_[p];
+    }
+    num_boards_ += other.num_boards_;
+  }
+
+  EquityResult result() const {
+    EquityResult result;
+    result.num_boards = num_boards_;
+    double num_boards = std::max<uint64_t>(num_boards_, 1);
+    for (size_t p = 0; p < wins_.size(); p++) {
+      result.win.push_back(wins_[p] / num_boards);
+      result.tie.push_back(ties_[p] / num_boards);
+      result.equity.push_back(shares_[p] / (kShareUnit * num_boards));
+    }
+    return result;
+  }
+
+ private:
+  std::vector<uint64_t> wins_;
+  std::vector<uint64_t> ties_;
+  std::vector<uint64_t> shares_;
+  uint64_t num_boards_ = 0;
+};
+
+// Validates the cards of an equity query, whose boards have board_size
+// cards, flattens the hole cards into `holes` and lists every card the board
+// must avoid in `excluded`.
+template <typename HoleCards, typename BoardContainer, typename DeadContainer>
+void collect_equity_cards(const std::vector<HoleCards>& hole_cards,
+                          const BoardContainer& board_prefix,
+                          const DeadContainer& dead_cards,
+                          size_t board_size,
+                          std::vector<uint32_t>* holes,
+                          std::vector<uint32_t>* excluded) {
+  if (hole_cards.size() > kMaxEquityPlayers) {
+    throw std::invalid_argument("equity: too many players");
+  }
+  if (std::size(board_prefix) > board_size) {
+    throw std::invalid_argument("equity: board prefix is too long");
+  }
+
+  bool seen_cards[52] = {};
+  auto claim = [&](uint32_t card) {
+    if (card >= 52 || seen_cards[card]) {
+      throw std::invalid_argument("equity: card " + std::to_string(card) + " is repeated or out of range");
+    }
+    seen_cards[card] = true;
+  };
+  for (const auto& hole : hole_cards) {
+    for (auto card : hole) {
+      claim(card);
+      holes->push_back(card);
+      excluded->push_back(card);
+    }
+  }
+  if (holes->size() != 2 * hole_cards.size()) {
+    throw std::invalid_argument("equity: every player needs exactly two hole cards");
+  }
+  for (auto card : board_prefix) {
+    claim(card);
+  }
+  for (auto card : dead_cards) {
+    claim(card);
+    excluded->push_back(card);
+  }
+  size_t live = 52 - excluded->size() - std::size(board_prefix);
+  if (live < board_size - std::size(board_prefix)) {
+    throw std::invalid_argument("equity: not enough live cards to complete the board");
+  }
+}
+
+// Marks every card of `cards` in seen_cards. Throws std::invalid_argument,
+// naming the caller `what`, on a repeated or out-of-range card.
+template <typename Container>
+void claim_cards(const Container& cards, bool* seen_cards, const char* what) {
+  for (auto card : cards) {
+    if (static_cast<uint32_t>(card) >= 52 || seen_cards[card]) {
+      throw std::invalid_argument(std::string(what) + ": card " + std::to_string(card) +
+                                  " is repeated or out of range");
+    }
+    seen_cards[card] = true;
+  }
+}
+
+inline size_t resolve_num_threads(size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  return std::max<size_t>(num_threads, 1);
+}
+
+// Row encoding flags of compressed tables.
+constexpr uint8_t kRowDictionary = 1;
+constexpr uint8_t kRowScaled = 2;
+// Upper bound on the size of one encoded row: a dictionary of 52 32-bit
+// values and 52 6-bit indices.
+constexpr size_t kMaxEncodedRowBytes = 7 + (52 * 32 + 52 * 6 + 7) / 8;
+
+// 64-bit multiply-xorshift hash of num_bytes of data, which must be a
+// multiple of 8.
+inline uint64_t table_checksum(const void* data, size_t num_bytes, uint64_t seed = 0) {
+  const char* bytes = static_cast<const char*>(data);
+  uint64_t hash = seed ^ 0x243F6A8885A308D3ull ^ num_bytes;
+  for (size_t i = 0; i < num_bytes; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+    hash ^= hash >> 32;
+  }
+  return hash;
+}
+
+// Checksum of a compressed table header and its chunk directory.
+inline uint64_t compressed_header_checksum(PheCompressedHeader header,
+                                           const std::vector<PheCompressedChunk>& chunks) {
+  header.checksum = 0;
+  uint64_t hash = table_checksum(&header, sizeof(header));
+  return table_checksum(chunks.data(), chunks.size() * sizeof(PheCompressedChunk), hash);
+}
+
+// Reads `bits` bits, LSB first, at bit offset `bit` of `in`. `in` must be
+// readable for 8 bytes past the byte holding the first bit.
+inline uint32_t read_bits(const uint8_t* in, uint64_t bit, uint32_t bits) {
+  uint64_t word;
+  std::memcpy(&word, in + bit / 8, sizeof(word));
+  return static_cast<uint32_t>((word >> (bit % 8)) & ((uint64_t{1} << bits) - 1));
+}
+
+// Decodes one 52-slot row into `out`, and returns the start of the next row.
+inline const uint8_t* decode_row(const uint8_t* in, uint32_t* out) {
+  uint8_t flags = in[0];
+  uint32_t value_bits = in[1];
+  uint32_t base;
+  std::memcpy(&base, in + 2, sizeof(base));
+  in += 6;
+  uint32_t scale = (flags & kRowScaled) ? 52 : 1;
+
+  uint64_t bit = 0;
+  if (flags & kRowDictionary) {
+    uint32_t num_values = uint32_t{*in++} + 1;
+    // Indices are up to 6 bits wide. A corrupt index past num_values reads
+    // a zero, and the chunk then fails its checksum.
+    uint32_t values[64] = {};
+    for (uint32_t i = 0; i < num_values; i++, bit += value_bits) {
+      values[i] = base + read_bits(in, bit, value_bits) * scale;
+    }
+    uint32_t index_bits = num_values > 1 ? 32 - __builtin_clz(num_values - 1) : 0;
+    for (uint32_t card = 0; card < 52; card++, bit += index_bits) {
+      out[card] = values[read_bits(in, bit, index_bits)];
+    }
+  } else {
+    for (uint32_t card = 0; card < 52; card++, bit += value_bits) {
+      out[card] = base + read_bits(in, bit, value_bits) * scale;
+    }
+  }
+  return in + (bit + 7) / 8;
+}
+
+inline std::shared_ptr<const void> load_compressed_table(int fd,
+                                                         size_t file_bytes,
+                                                         const std::string& path,
+                                                         const PheLoadOptions& options,
+                                                         uint32_t expected_hand_size,
+                                                         size_t* num_bytes) {
+  auto corrupt = [&](const std::string& what) {
+    return std::runtime_error(path + ": " + what);
+  };
+
+  PheCompressedHeader header;
+  pread_all(fd, &header, sizeof(header), 0, path);
+  if (header.version != PheCompressedHeader::kVersion) {
+    throw corrupt("unsupported compressed table version " + std::to_string(header.version));
+  }
+  if (expected_hand_size != 0 && header.hand_size != expected_hand_size) {
+    throw corrupt("table is for a different hand size");
+  }
+  if (std::string(header.card_mapping, strnlen(header.card_mapping, sizeof(header.card_mapping))) != "rank-major" ||
+      std::string(header.score_semantics, strnlen(header.score_semantics, sizeof(header.score_semantics))) != "cactus-kev") {
+    throw corrupt("unsupported card mapping or score semantics");
+  }
+  uint64_t rows_per_chunk = header.rows_per_chunk;
+  uint64_t num_rows = header.num_entries / 52;
+  if (header.num_entries % 52 != 0 || rows_per_chunk == 0 ||
+      header.num_chunks != (num_rows + rows_per_chunk - 1) / rows_per_chunk ||
+      sizeof(header) + uint64_t{header.num_chunks} * sizeof(PheCompressedChunk) > file_bytes) {
+    throw corrupt("corrupt compressed table header");
+  }
+
+  std::vector<PheCompressedChunk> chunks(header.num_chunks);
+  pread_all(fd, chunks.data(), chunks.size() * sizeof(PheCompressedChunk), sizeof(header), path);
+  if (compressed_header_checksum(header, chunks) != header.checksum) {
+    throw corrupt("compressed table header checksum mismatch");
+  }
+  for (const auto& chunk : chunks) {
+    if (chunk.offset > file_bytes || chunk.num_bytes > file_bytes - chunk.offset) {
+      throw corrupt("truncated compressed table");
+    }
+  }
+
+  *num_bytes = header.num_entries * sizeof(uint32_t);
+  size_t map_bytes = 0;
+  auto owner = map_anonymous(*num_bytes, path, options, &map_bytes);
+  uint32_t* table = static_cast<uint32_t*>(const_cast<void*>(owner.get()));
+
+  // Each worker reads a chunk into its own buffer, padded for read_bits, and
+  // decodes it straight into the table.
+  size_t num_workers = std::min<size_t>(resolve_num_threads(options.decode_threads), chunks.size());
+  std::vector<std::vector<uint8_t>> buffers(num_workers);
+  std::vector<std::string> errors(chunks.size());
+  run_work_stealing(chunks.size(), std::max<size_t>(num_workers, 1), [&](size_t worker, size_t task) {
+    const PheCompressedChunk& chunk = chunks[task];
+    uint64_t first_row = task * rows_per_chunk;
+    uint64_t chunk_rows = std::min(rows_per_chunk, num_rows - first_row);
+    uint32_t* out = table + first_row * 52;
+
+    std::vector<uint8_t>& buffer = buffers[worker];
+    buffer.assign(chunk.num_bytes + kMaxEncodedRowBytes + sizeof(uint64_t), 0);
+    try {
+      pread_all(fd, buffer.data(), chunk.num_bytes, chunk.offset, path);
+    } catch (const std::exception& e) {
+      errors[task] = e.what();
+      return;
+    }
+
+    const uint8_t* in = buffer.data();
+    const uint8_t* end = in + chunk.num_bytes;
+    for (uint64_t row = 0; row < chunk_rows; row++) {
+      // Reject rows that would decode past the padding.
+      if (in >= end || in[1] > 32 || ((in[0] & kRowDictionary) && in[6] >= 52)) {
+        errors[task] = "corrupt chunk " + std::to_string(task);
+        return;
+      }
+      in = decode_row(in, out + row * 52);
+    }
+    if (in != end || table_checksum(out, chunk_rows * 52 * sizeof(uint32_t)) != chunk.checksum) {
+      errors[task] = "checksum mismatch in chunk " + std::to_string(task);
+    }
+  });
+  for (const auto& error : errors) {
+    if (!error.empty()) {
+      throw corrupt(error);
+    }
+  }
+
+  mprotect(table, map_bytes, PROT_READ);
+  return owner;
+}
+
+}  // namespace details
+
+inline SimdIsa detect_simd_isa() {
+#ifdef PHE_HAVE_X86_SIMD
+  static const SimdIsa isa = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return SimdIsa::kAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      return SimdIsa::kAvx2;
+    }
+    return SimdIsa::kScalar;
+  }();
+  return isa;
+#else
+  return SimdIsa::kScalar;
+#endif
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+PokerHandEval<hand_size, Instrumentation>::PokerHandEval(const std::string& path)
+    : PokerHandEval(path, PheLoadOptions()) {}
+
+template <uint8_t hand_size, typename Instrumentation>
+PokerHandEval<hand_size, Instrumentation>::PokerHandEval(const std::string& path,
+                                                         const PheLoadOptions& options) {
+  size_t num_bytes = 0;
+  storage_ = details::load_table(path, options, &num_bytes, hand_size);
+  table_ = static_cast<const uint32_t*>(storage_.get());
+  table_size_ = num_bytes / sizeof(uint32_t);
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+PokerHandEval<hand_size, Instrumentation>::PokerHandEval(std::shared_ptr<const uint32_t> table, size_t table_size)
+    : table_(table.get()), table_size_(table_size), storage_(std::move(table)) {}
+
+template <uint8_t hand_size, typename Instrumentation>
+PokerHandEval<hand_size, Instrumentation>::PokerHandEval(const uint32_t* table, size_t table_size)
+    : table_(table), table_size_(table_size) {}
+
+template <uint8_t hand_size, typename Instrumentation>
+PokerHandEval<hand_size, Instrumentation>::PokerHandEval(PokerHandEval&& other) noexcept
+    : table_(std::exchange(other.table_, nullptr)),
+      table_size_(std::exchange(other.table_size_, 0)),
+      storage_(std::move(other.storage_)),
+      generation_(other.generation_) {}
+
+template <uint8_t hand_size, typename Instrumentation>
+PokerHandEval<hand_size, Instrumentation>& PokerHandEval<hand_size, Instrumentation>::operator=(
+    PokerHandEval&& other) noexcept {
+  if (this != &other) {
+    table_ = std::exchange(other.table_, nullptr);
+    table_size_ = std::exchange(other.table_size_, 0);
+    storage_ = std::move(other.storage_);
+    generation_ = other.generation_;
+  }
+  return *this;
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename... CardType>
+uint32_t PokerHandEval<hand_size, Instrumentation>::eval(CardType... hand) const {
+  if constexpr (Instrumentation::kEnabled) {
+    static_assert(sizeof...(hand) == hand_size, "Wrong number of arguments.");
+    const uint32_t cards[] = {static_cast<uint32_t>(hand)...};
+    return eval_instrumented(std::begin(cards));
+  } else {
+    return details::EvalHelper<hand_size>::eval_cards(table_, hand...);
+  }
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename Container>
+uint32_t PokerHandEval<hand_size, Instrumentation>::eval(const Container& hand) const {
+  if constexpr (Instrumentation::kEnabled) {
+    return eval_instrumented(std::begin(hand));
+  } else {
+    return details::EvalHelper<hand_size>::eval_iterator(table_, std::begin(hand));
+  }
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename Iterator>
+uint32_t PokerHandEval<hand_size, Instrumentation>::eval_instrumented(Iterator it) const {
+  uint32_t cards[hand_size];
+  std::copy_n(it, hand_size, cards);
+
+  typename Instrumentation::Probe probe(table_, table_size_, hand_size, generation_);
+  // Same walk as eval, which consumes the last card first.
+  uint32_t index = 0;
+  for (int i = hand_size - 1; i >= 0; i--) {
+    probe.visit(hand_size - 1 - i, index + cards[i]);
+    index = table_[index + cards[i]];
+  }
+  probe.finish();
+  return index;
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename Container>
+uint32_t PokerHandEval<hand_size, Instrumentation>::eval_recorded(const Container& hand, RowHistogram* histogram) const {
+  uint32_t cards[hand_size];
+  std::copy_n(std::begin(hand), hand_size, cards);
+
+  // eval consumes the last card first.
+  uint32_t index = 0;
+  for (int i = hand_size - 1; i >= 0; i--) {
+    histogram->add(index / 52);
+    index = table_[index + cards[i]];
+  }
+  return index;
+}
+
+inline RowHistogram::RowHistogram(const std::string& path) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  RowHistogramHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, RowHistogramHeader::kMagic, sizeof(header.magic)) != 0 ||
+      header.version != RowHistogramHeader::kVersion) {
+    throw std::runtime_error(path + ": not a row histogram");
+  }
+  hand_size_ = header.hand_size;
+  counts_.resize(header.num_rows);
+  if (!file.read(reinterpret_cast<char*>(counts_.data()), counts_.size() * sizeof(uint64_t))) {
+    throw std::runtime_error(path + ": truncated row histogram");
+  }
+}
+
+inline void RowHistogram::save(const std::string& path) const {
+  RowHistogramHeader header;
+  std::memcpy(header.magic, RowHistogramHeader::kMagic, sizeof(header.magic));
+  header.version = RowHistogramHeader::kVersion;
+  header.hand_size = hand_size_;
+  header.num_rows = counts_.size();
+
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(counts_.data()), counts_.size() * sizeof(uint64_t));
+  if (!file) {
+    throw std::runtime_error(path + ": failed to write row histogram");
+  }
+}
+
+inline void RowHistogram::merge(const RowHistogram& other) {
+  if (other.hand_size_ != hand_size_ || other.counts_.size() != counts_.size()) {
+    throw std::invalid_argument("RowHistogram::merge: histograms of different tables");
+  }
+  for (size_t row = 0; row < counts_.size(); row++) {
+    counts_[row] += other.counts_[row];
+  }
+}
+
+template <uint8_t hand_size, uint8_t depth>
+template <typename CardType>
+EvalState<hand_size, depth + 1> EvalState<hand_size, depth>::append(CardType card) const {
+  static_assert(depth < hand_size, "Cannot append to a complete hand.");
+  return {table_, table_[state_ + card]};
+}
+
+template <uint8_t hand_size, uint8_t depth>
+template <typename CardType, typename... Tail>
+EvalState<hand_size, depth + 1 + sizeof...(Tail)> EvalState<hand_size, depth>::append(CardType card,
+                                                                                     Tail... rest) const {
+  if constexpr (sizeof...(Tail) == 0) {
+    return append(card);
+  } else {
+    return append(card).append(rest...);
+  }
+}
+
+template <uint8_t hand_size, uint8_t depth>
+uint32_t EvalState<hand_size, depth>::score() const {
+  static_assert(depth == hand_size, "score() requires a complete hand.");
+  return state_;
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+EvalState<hand_size> PokerHandEval<hand_size, Instrumentation>::start() const {
+  return {table_, 0};
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename Hand>
+void PokerHandEval<hand_size, Instrumentation>::eval_batch(const Hand* in, uint32_t* out, size_t n) const {
+  size_t i = 0;
+  for (; i + details::kBatchLanes <= n; i += details::kBatchLanes) {
+    details::eval_lanes<hand_size>(table_, in + i, out + i, details::kBatchLanes);
+  }
+  if (i < n) {
+    details::eval_lanes<hand_size>(table_, in + i, out + i, n - i);
+  }
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename HandContainer, typename ScoreContainer>
+void PokerHandEval<hand_size, Instrumentation>::eval_batch(const HandContainer& hands,
+                                                           ScoreContainer* scores) const {
+  eval_batch(std::data(hands), std::data(*scores), std::size(hands));
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+void PokerHandEval<hand_size, Instrumentation>::eval_soa(const std::array<const uint32_t*, hand_size>& cards,
+                                                         uint32_t* out,
+                                                         size_t n) const {
+  eval_soa(cards, out, n, detect_simd_isa());
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+void PokerHandEval<hand_size, Instrumentation>::eval_soa(const std::array<const uint32_t*, hand_size>& cards,
+                                                         uint32_t* out,
+                                                         size_t n,
+                                                         SimdIsa isa) const {
+  switch (isa) {
+#ifdef PHE_HAVE_X86_SIMD
+    case SimdIsa::kAvx512:
+      details::eval_soa_avx512<hand_size>(table_, cards.data(), out, n);
+      return;
+    case SimdIsa::kAvx2:
+      details::eval_soa_avx2<hand_size>(table_, cards.data(), out, n);
+      return;
+#endif
+    default:
+      details::eval_soa_scalar<hand_size>(table_, cards.data(), out, n);
+      return;
+  }
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+std::vector<uint32_t> PokerHandEval<hand_size, Instrumentation>::eval_soa(
+    const std::array<std::vector<uint32_t>, hand_size>& cards) const {
+  std::array<const uint32_t*, hand_size> lanes;
+  for (uint8_t card_idx = 0; card_idx < hand_size; card_idx++) {
+    lanes[card_idx] = cards[card_idx].data();
+  }
+  std::vector<uint32_t> out(cards[0].size());
+  eval_soa(lanes, out.data(), out.size());
+  return out;
+}
+
+template <uint8_t hand_size, typename Instrumentation>
 template <typename Fn>
-void PokerHandEval<hand_size>::sweep(Fn fn) const {
+void PokerHandEval<hand_size, Instrumentation>::sweep(Fn fn) const {
   uint32_t stack[hand_size + 1] = {};
   std::array<uint32_t, hand_size> hand;
 
@@ -146,66 +1520,277 @@ void PokerHandEval<hand_size>::sweep(Fn fn) const {
   }
 }
 
-template <uint8_t hand_size>
+template <uint8_t hand_size, typename Instrumentation>
 template <typename Container, typename Fn>
-void PokerHandEval<hand_size>::sweep(const Container& prefix, Fn fn) const {
+void PokerHandEval<hand_size, Instrumentation>::sweep(const Container& prefix, Fn fn) const {
+  if (std::size(prefix) > hand_size) {
+    throw std::invalid_argument("sweep: the prefix is longer than the hand");
+  }
+  bool seen_cards[52] = {};
+  details::claim_cards(prefix, seen_cards, "sweep");
+
   uint32_t stack[hand_size + 1] = {};
   std::array<uint32_t, hand_size> hand;
 
-  // Signed prefix size to simplify comparisons.
-  auto prefix_size = static_cast<int32_t>(prefix.size());
-
   // Populate with prefix cards.
-  uint32_t seen_cards[52] = {};
-  for (uint32_t i = 0; i < prefix_size; i++) {
-    hand[i] = prefix[i];
-    stack[i + 1] = table_[stack[i] + hand[i]];
-
-    seen_cards[hand[i]] = true;
+  uint32_t prefix_size = 0;
+  for (auto card : prefix) {
+    hand[prefix_size] = card;
+    stack[prefix_size + 1] = table_[stack[prefix_size] + card];
+    prefix_size++;
   }
 
   // Build deck with remaining cards.
-  uint32_t deck_size = 52 - prefix_size;
-  uint32_t deck[deck_size];
-  uint32_t deck_lookup[52];
-  for (uint32_t di = 0, c = 0; c < 52; c++) {
+  uint32_t deck[52];
+  uint32_t deck_size = 0;
+  for (uint32_t c = 0; c < 52; c++) {
     if (!seen_cards[c]) {
-      deck[di] = c;
-      deck_lookup[c] = di;
-      di++;
+      deck[deck_size++] = c;
     }
   }
 
-  // Create first legal hand.
-  for (uint32_t hand_idx = prefix_size; hand_idx < hand_size; hand_idx++) {
-    hand[hand_idx] = deck[hand_idx - prefix_size];
-    stack[hand_idx + 1] = table_[stack[hand_idx] + hand[hand_idx]];
+  details::sweep_deck<hand_size>(table_, hand, stack, prefix_size, deck, 0, deck_size, fn);
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename Fn>
+void PokerHandEval<hand_size, Instrumentation>::sweep_blocks(Fn fn) const {
+  sweep_blocks(std::array<uint32_t, 0>{}, fn);
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename Container, typename Fn>
+void PokerHandEval<hand_size, Instrumentation>::sweep_blocks(const Container& prefix, Fn fn) const {
+  static_assert(hand_size >= 1, "Blocks need at least one card per hand.");
+  constexpr uint8_t depth = hand_size - 1;
+  if (std::size(prefix) > depth) {
+    throw std::invalid_argument("sweep_blocks: the prefix must leave at least one card");
   }
-  fn(hand, stack[hand_size]);
+  bool seen_cards[52] = {};
+  details::claim_cards(prefix, seen_cards, "sweep_blocks");
 
-  // Generate all remaining hands.
-  while (true) {
-    int32_t start_idx = hand_size - 1;
-    while (start_idx >= prefix_size) {
-      uint32_t card = deck_lookup[hand[start_idx]];
-      uint32_t max_card = deck_size - (hand_size - start_idx);
+  uint32_t stack[depth + 1] = {};
+  std::array<uint32_t, depth> partial;
+  uint32_t prefix_size = 0;
+  uint64_t free_cards = (uint64_t{1} << 52) - 1;
+  for (auto card : prefix) {
+    partial[prefix_size] = card;
+    stack[prefix_size + 1] = table_[stack[prefix_size] + card];
+    prefix_size++;
+    free_cards &= ~(uint64_t{1} << card);
+  }
 
-      if (card < max_card) {
-        // Found the rightmost position that can be incremented.
-        break;
-      }
-      start_idx--;
+  uint32_t deck[52];
+  uint32_t deck_size = 0;
+  for (uint32_t c = 0; c < 52; c++) {
+    if (free_cards >> c & 1) {
+      deck[deck_size++] = c;
     }
-    if (start_idx < prefix_size) {
-      return;
+  }
+
+  auto visit = [&](const std::array<uint32_t, depth>& cards, uint32_t row) {
+    int32_t last_free_card = prefix_size < depth ? static_cast<int32_t>(cards[depth - 1]) : -1;
+    uint64_t valid_cards = details::block_valid_cards(free_cards, last_free_card);
+    if (valid_cards != 0) {
+      fn(cards, table_ + row, valid_cards);
     }
+  };
+  details::sweep_deck<depth>(table_, partial, stack, prefix_size, deck, 0, deck_size, visit);
+}
 
-    // Advance the pivot and refill the tail with the smallest possible cards.
-    uint32_t deck_idx = deck_lookup[hand[start_idx]] + 1;
-    for (uint32_t hand_idx = start_idx; hand_idx < hand_size; hand_idx++, deck_idx++) {
-      hand[hand_idx] = deck[deck_idx];
-      stack[hand_idx + 1] = table_[stack[hand_idx] + hand[hand_idx]];
+template <uint8_t hand_size, typename Instrumentation>
+template <typename Container, typename DeadContainer, typename Accumulator, typename Fn, typename Merge>
+Accumulator PokerHandEval<hand_size, Instrumentation>::parallel_sweep_blocks(const Container& prefix,
+                                                                             const DeadContainer& dead_cards,
+                                                                             const Accumulator& init,
+                                                                             Fn fn,
+                                                                             Merge merge,
+                                                                             size_t num_threads) const {
+  static_assert(hand_size >= 1, "Blocks need at least one card per hand.");
+  constexpr uint8_t depth = hand_size - 1;
+  const uint32_t prefix_size = std::size(prefix);
+  if (prefix_size > depth) {
+    throw std::invalid_argument("parallel_sweep_blocks: the prefix must leave at least one card");
+  }
+  bool seen_cards[52] = {};
+  details::claim_cards(prefix, seen_cards, "parallel_sweep_blocks");
+  for (auto card : dead_cards) {
+    if (static_cast<uint32_t>(card) >= 52) {
+      throw std::invalid_argument("parallel_sweep_blocks: dead card " + std::to_string(card) + " is out of range");
     }
-    fn(hand, stack[hand_size]);
   }
+
+  uint64_t free_cards = (uint64_t{1} << 52) - 1;
+  for (auto card : prefix) {
+    free_cards &= ~(uint64_t{1} << card);
+  }
+  for (auto card : dead_cards) {
+    free_cards &= ~(uint64_t{1} << card);
+  }
+
+  auto visit = [&](Accumulator* accumulator, const std::array<uint32_t, hand_size>& hand, uint32_t row) {
+    int32_t last_free_card = prefix_size < depth ? static_cast<int32_t>(hand[depth - 1]) : -1;
+    uint64_t valid_cards = details::block_valid_cards(free_cards, last_free_card);
+    if (valid_cards != 0) {
+      std::array<uint32_t, depth> partial;
+      std::copy_n(hand.begin(), depth, partial.begin());
+      fn(accumulator, static_cast<const std::array<uint32_t, depth>&>(partial), table_ + row, valid_cards);
+    }
+  };
+  return parallel_sweep_to<depth>(prefix, dead_cards, init, visit, merge, num_threads);
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename Accumulator, typename Fn, typename Merge>
+Accumulator PokerHandEval<hand_size, Instrumentation>::parallel_sweep(const Accumulator& init,
+                                                                      Fn fn,
+                                                                      Merge merge,
+                                                                      size_t num_threads) const {
+  return parallel_sweep(std::array<uint32_t, 0>{}, std::array<uint32_t, 0>{}, init, fn, merge, num_threads);
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename Container, typename DeadContainer, typename Accumulator, typename Fn, typename Merge>
+Accumulator PokerHandEval<hand_size, Instrumentation>::parallel_sweep(const Container& prefix,
+                                                                      const DeadContainer& dead_cards,
+                                                                      const Accumulator& init,
+                                                                      Fn fn,
+                                                                      Merge merge,
+                                                                      size_t num_threads) const {
+  return parallel_sweep_to<hand_size>(prefix, dead_cards, init, fn, merge, num_threads);
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <uint8_t depth, typename Container, typename DeadContainer, typename Accumulator, typename Fn, typename Merge>
+Accumulator PokerHandEval<hand_size, Instrumentation>::parallel_sweep_to(const Container& prefix,
+                                                                         const DeadContainer& dead_cards,
+                                                                         const Accumulator& init,
+                                                                         Fn fn,
+                                                                         Merge merge,
+                                                                         size_t num_threads) const {
+  if (std::size(prefix) > depth) {
+    throw std::invalid_argument("parallel_sweep: the prefix is longer than the hand");
+  }
+  num_threads = details::resolve_num_threads(num_threads);
+
+  bool seen_cards[52] = {};
+  details::claim_cards(prefix, seen_cards, "parallel_sweep");
+  // Dead cards may repeat each other or the prefix.
+  for (auto card : dead_cards) {
+    if (static_cast<uint32_t>(card) >= 52) {
+      throw std::invalid_argument("parallel_sweep: dead card " + std::to_string(card) + " is out of range");
+    }
+    seen_cards[card] = true;
+  }
+
+  std::array<uint32_t, hand_size> prefix_hand;
+  uint32_t prefix_size = 0;
+  for (auto card : prefix) {
+    prefix_hand[prefix_size++] = card;
+  }
+
+  uint32_t deck[52];
+  uint32_t deck_size = 0;
+  for (uint32_t c = 0; c < 52; c++) {
+    if (!seen_cards[c]) {
+      deck[deck_size++] = c;
+    }
+  }
+
+  // Split on up to two more leading cards, always leaving at least one card
+  // to the per-task sweep. For a full 7-card sweep this gives 1,326 tasks
+  // whose sizes range from C(50, 5) hands down to a single hand.
+  const uint32_t split_size = std::min<uint32_t>(prefix_size + 2, std::max<uint32_t>(prefix_size, depth - 1));
+
+  // Each task is identified by the deck positions of its split cards.
+  // Enumerating them in lexicographic order yields the largest subtrees
+  // first.
+  std::vector<std::array<uint8_t, 2>> tasks;
+  switch (split_size - prefix_size) {
+    case 0:
+      tasks.push_back({0, 0});
+      break;
+    case 1:
+      for (uint32_t a = 0; a < deck_size; a++) {
+        tasks.push_back({static_cast<uint8_t>(a), 0});
+      }
+      break;
+    default:
+      for (uint32_t a = 0; a < deck_size; a++) {
+        for (uint32_t b = a + 1; b < deck_size; b++) {
+          tasks.push_back({static_cast<uint8_t>(a), static_cast<uint8_t>(b)});
+        }
+      }
+      break;
+  }
+
+  struct alignas(64) Partial {
+    Accumulator accumulator;
+  };
+  std::vector<Partial> partials(num_threads, Partial{init});
+
+  auto run_task = [&](size_t worker, size_t task_idx) {
+    const auto& task = tasks[task_idx];
+    Accumulator* accumulator = &partials[worker].accumulator;
+
+    uint32_t stack[depth + 1] = {};
+    std::array<uint32_t, hand_size> hand = prefix_hand;
+    for (uint32_t i = 0; i < prefix_size; i++) {
+      stack[i + 1] = table_[stack[i] + hand[i]];
+    }
+    uint32_t deck_begin = 0;
+    for (uint32_t i = prefix_size; i < split_size; i++) {
+      uint32_t deck_idx = task[i - prefix_size];
+      hand[i] = deck[deck_idx];
+      stack[i + 1] = table_[stack[i] + hand[i]];
+      deck_begin = deck_idx + 1;
+    }
+
+    auto visit = [&](const std::array<uint32_t, hand_size>& h, uint32_t state) {
+      fn(accumulator, h, state);
+    };
+    details::sweep_deck<depth>(table_, hand, stack, split_size, deck, deck_begin, deck_size, visit);
+  };
+
+  details::run_work_stealing(tasks.size(), num_threads, run_task);
+
+  Accumulator total = std::move(partials[0].accumulator);
+  for (size_t i = 1; i < num_threads; i++) {
+    merge(&total, partials[i].accumulator);
+  }
+  return total;
+}
+
+template <uint8_t hand_size, typename Instrumentation>
+template <typename HoleCards, typename BoardContainer, typename DeadContainer>
+EquityResult PokerHandEval<hand_size, Instrumentation>::equity(const std::vector<HoleCards>& hole_cards,
+                                                               const BoardContainer& board_prefix,
+                                                               const DeadContainer& dead_cards,
+                                                               size_t num_threads) const {
+  static_assert(hand_size > 2, "Equity requires two hole cards plus a board.");
+  constexpr uint8_t board_size = hand_size - 2;
+
+  // Hole cards are flattened and, along with the dead cards, removed from the
+  // deck the board is drawn from.
+  std::vector<uint32_t> holes;
+  std::vector<uint32_t> excluded;
+  details::collect_equity_cards(hole_cards, board_prefix, dead_cards, board_size, &holes, &excluded);
+  const size_t num_players = hole_cards.size();
+
+  auto tally_board = [&](details::EquityTally* tally, const std::array<uint32_t, hand_size>&, uint32_t board_state) {
+    EvalState<hand_size, board_size> board(table_, board_state);
+    uint32_t scores[details::kMaxEquityPlayers];
+    for (size_t p = 0; p < num_players; p++) {
+      scores[p] = board.append(holes[2 * p], holes[2 * p + 1]).score();
+    }
+    tally->add(scores);
+  };
+
+  auto merge = [](details::EquityTally* total, const details::EquityTally& partial) {
+    total->merge(partial);
+  };
+
+  return parallel_sweep_to<board_size>(board_prefix, excluded, details::EquityTally(num_players),
+                                       tally_board, merge, num_threads)
+      .result();
 }
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "poker_hand_eval.h"
+
+// Monte Carlo simulation on top of PokerHandEval.
+//
+// Example usage:
+//   PokerHandEval<7> phe("/path/to/table7.phe");
+//   std::vector<std::array<int, 2>> holes = {{48, 49}, {44, 40}, {0, 5}};
+//   EquityResult r = monte_carlo_equity(phe, holes, std::vector<int>{}, std::vector<int>{},
+//                                       /*num_samples=*/100000000, /*seed=*/42);
+//
+// Random hands can also be dealt in bulk and evaluated with eval_batch:
+//   Xoshiro256 rng(42);
+//   Dealer dealer(std::vector<int>{/* dead cards */});
+//   std::vector<std::array<uint8_t, 7>> hands(4096);
+//   dealer.deal_hands(&rng, hands.data(), hands.size());
+//   phe.eval_batch(hands, &scores);
+
+// xoshiro256** (Blackman & Vigna), a small and fast generator with a 2^256 - 1
+// period. Satisfies UniformRandomBitGenerator.
+class Xoshiro256 {
+ public:
+  using result_type = uint64_t;
+
+  // Expands `seed` into the full state with splitmix64.
+  explicit Xoshiro256(uint64_t seed);
+
+  // Returns the generator for stream `stream` of `seed`. Streams of the same
+  // seed are seeded independently, so any stream can be created in O(1) and
+  // reproduced without reference to the others.
+  static Xoshiro256 for_stream(uint64_t seed, uint64_t stream);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+
+  result_type operator()();
+
+  // Advances the generator by 2^128 steps. Calling jump() k times on copies
+  // of one generator yields k provably non-overlapping sequences.
+  void jump();
+
+  // Returns a uniformly distributed integer in [0, range), using Lemire's
+  // multiply-shift method with rejection.
+  uint32_t bounded(uint32_t range);
+
+ private:
+  uint64_t s_[4];
+};
+
+// Deals cards without replacement from the live deck: every card except the
+// given dead cards.
+//
+// Each deal is a partial Fisher-Yates shuffle of the live deck, so dealing k
+// cards costs k random numbers, and the deck never needs to be reset between
+// deals.
+class Dealer {
+ public:
+  Dealer() : Dealer(std::array<uint8_t, 0>{}) {}
+
+  template <typename DeadContainer>
+  explicit Dealer(const DeadContainer& dead_cards);
+
+  // Number of live cards.
+  uint32_t size() const { return size_; }
+
+  // Writes n distinct live cards to out[0, n).
+  template <typename Rng, typename CardType>
+  void deal(Rng* rng, CardType* out, uint32_t n);
+
+  // Fills hands[0, n) with independent random hands, each of distinct live
+  // cards. Hand is any random-access container of a fixed number of cards,
+  // e.g. std::array<uint8_t, 7>, which eval_batch consumes directly.
+  template <typename Rng, typename Hand>
+  void deal_hands(Rng* rng, Hand* hands, size_t n);
+
+ private:
+  uint8_t deck_[52];
+  uint32_t size_ = 0;
+};
+
+// Estimates all-in equity by sampling num_samples random board completions.
+//
+// Samples are drawn in fixed-size blocks, each with its own stream of `seed`,
+// and blocks are scheduled on num_threads threads (0 means one per hardware
+// thread). The result depends only on the inputs and the seed, not on the
+// number of threads.
+//
+// Throws std::invalid_argument, before any thread starts, for cards that are
+// repeated or out of range and for boards longer than hand_size - 2 cards.
+template <uint8_t hand_size, typename HoleCards, typename BoardContainer, typename DeadContainer>
+EquityResult monte_carlo_equity(const PokerHandEval<hand_size>& phe,
+                                const std::vector<HoleCards>& hole_cards,
+                                const BoardContainer& board_prefix,
+                                const DeadContainer& dead_cards,
+                                uint64_t num_samples,
+                                uint64_t seed,
+                                size_t num_threads = 0);
+
+//////////////////////////////////
+// Implementation details below //
+//////////////////////////////////
+
+namespace details {
+
+inline uint64_t splitmix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+inline uint64_t rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+}  // namespace details
+
+inline Xoshiro256::Xoshiro256(uint64_t seed) {
+  for (auto& s : s_) {
+    s = details::splitmix64(&seed);
+  }
+}
+
+inline Xoshiro256 Xoshiro256::for_stream(uint64_t seed, uint64_t stream) {
+  uint64_t x = seed;
+  uint64_t stream_seed = details::splitmix64(&x) ^ (stream * 0xd1b54a32d192ed03ull);
+  return Xoshiro256(details::splitmix64(&stream_seed));
+}
+
+inline Xoshiro256::result_type Xoshiro256::operator()() {
+  const uint64_t result = details::rotl(s_[1] * 5, 7) * 9;
+  const uint64_t t = s_[1] << 17;
+
+  s_[2] ^= s_[0];
+  s_[3] ^= s_[1];
+  s_[1] ^= s_[2];
+  s_[0] ^= s_[3];
+
+  s_[2] ^= t;
+  s_[3] = details::rotl(s_[3], 45);
+
+  return result;
+}
+
+inline void Xoshiro256::jump() {
+  static constexpr uint64_t kJump[] = {0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull,
+                                       0xa9582618e03fc9aaull, 0x39abdc4529b1661cull};
+
+  uint64_t s[4] = {};
+  for (uint64_t jump : kJump) {
+    for (int b = 0; b < 64; b++) {
+      if (jump & (uint64_t{1} << b)) {
+        for (int i = 0; i < 4; i++) {
+          s[i] ^= s_[i];
+        }
+      }
+      (*this)();
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    s_[i] = s[i];
+  }
+}
+
+inline uint32_t Xoshiro256::bounded(uint32_t range) {
+  uint64_t m = ((*this)() >> 32) * range;
+  uint32_t low = static_cast<uint32_t>(m);
+  if (low < range) {
+    uint32_t threshold = -range % range;
+    while (low < threshold) {
+      m = ((*this)() >> 32) * range;
+      low = static_cast<uint32_t>(m);
+    }
+  }
+  return static_cast<uint32_t>(m >> 32);
+}
+
+template <typename DeadContainer>
+Dealer::Dealer(const DeadContainer& dead_cards) {
+  bool dead[52] = {};
+  for (auto card : dead_cards) {
+    dead[card] = true;
+  }
+  for (uint8_t c = 0; c < 52; c++) {
+    if (!dead[c]) {
+      deck_[size_++] = c;
+    }
+  }
+}
+
+template <typename Rng, typename CardType>
+void Dealer::deal(Rng* rng, CardType* out, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t j = i + rng->bounded(size_ - i);
+    std::swap(deck_[i], deck_[j]);
+    out[i] = deck_[i];
+  }
+}
+
+template <typename Rng, typename Hand>
+void Dealer::deal_hands(Rng* rng, Hand* hands, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    deal(rng, std::data(hands[i]), std::size(hands[i]));
+  }
+}
+
+namespace details {
+
+// Number of samples drawn from each random stream by monte_carlo_equity.
+constexpr uint64_t kSamplesPerBlock = 1 << 14;
+
+template <uint8_t hand_size, uint8_t depth, typename Cards, size_t... I>
+EvalState<hand_size, depth + sizeof...(I)> append_cards(const EvalState<hand_size, depth>& state,
+                                                        const Cards& cards,
+                                                        std::index_sequence<I...>) {
+  if constexpr (sizeof...(I) == 0) {
+    return state;
+  } else {
+    return state.append(cards[I]...);
+  }
+}
+
+// Samples one block of boards, given that `known` board cards are fixed.
+// The known cards are walked once, the missing ones are dealt and walked per
+// sample, and every player is finished off the shared board state.
+template <uint8_t hand_size, uint8_t known>
+void sample_equity_block(const PokerHandEval<hand_size>& phe,
+                         const std::vector<uint32_t>& holes,
+                         const std::vector<uint32_t>& board_prefix,
+                         Dealer dealer,
+                         Xoshiro256 rng,
+                         uint64_t num_samples,
+                         EquityTally* tally) {
+  constexpr uint8_t board_size = hand_size - 2;
+  constexpr uint8_t missing = board_size - known;
+  const size_t num_players = holes.size() / 2;
+
+  auto prefix_state = append_cards(phe.start(), board_prefix, std::make_index_sequence<known>());
+
+  uint8_t cards[missing + 1];
+  uint32_t scores[kMaxEquityPlayers];
+  for (uint64_t sample = 0; sample < num_samples; sample++) {
+    dealer.deal(&rng, cards, missing);
+    auto board = append_cards(prefix_state, cards, std::make_index_sequence<missing>());
+    for (size_t p = 0; p < num_players; p++) {
+      scores[p] = board.append(holes[2 * p], holes[2 * p + 1]).score();
+    }
+    tally->add(scores);
+  }
+}
+
+// Selects the sample_equity_block instantiation for the number of known board
+// cards.
+template <uint8_t hand_size, uint8_t known = 0>
+void dispatch_equity_block(const PokerHandEval<hand_size>& phe,
+                           const std::vector<uint32_t>& holes,
+                           const std::vector<uint32_t>& board_prefix,
+                           const Dealer& dealer,
+                           const Xoshiro256& rng,
+                           uint64_t num_samples,
+                           EquityTally* tally) {
+  if constexpr (known < hand_size - 2) {
+    if (board_prefix.size() != known) {
+      dispatch_equity_block<hand_size, known + 1>(phe, holes, board_prefix, dealer, rng, num_samples, tally);
+      return;
+    }
+  }
+  // This runs on the workers, where nothing may throw; monte_carlo_equity
+  // rejects longer boards before spawning them.
+  assert(board_prefix.size() == known);
+  sample_equity_block<hand_size, known>(phe, holes, board_prefix, dealer, rng, num_samples, tally);
+}
+
+}  // namespace details
+
+template <uint8_t hand_size, typename HoleCards, typename BoardContainer, typename DeadContainer>
+EquityResult monte_carlo_equity(const PokerHandEval<hand_size>& phe,
+                                const std::vector<HoleCards>& hole_cards,
+                                const BoardContainer& board_prefix,
+                                const DeadContainer& dead_cards,
+                                uint64_t num_samples,
+                                uint64_t seed,
+                                size_t num_threads) {
+  static_assert(hand_size > 2, "Equity requires two hole cards plus a board.");
+  num_threads = details::resolve_num_threads(num_threads);
+
+  std::vector<uint32_t> holes;
+  std::vector<uint32_t> excluded;
+  details::collect_equity_cards(hole_cards, board_prefix, dead_cards, hand_size - 2, &holes, &excluded);
+  std::vector<uint32_t> board(std::begin(board_prefix), std::end(board_prefix));
+  for (auto card : board) {
+    excluded.push_back(card);
+  }
+  const Dealer dealer(excluded);
+
+  const uint64_t num_blocks = (num_samples + details::kSamplesPerBlock - 1) / details::kSamplesPerBlock;
+
+  struct alignas(64) Partial {
+    details::EquityTally tally;
+  };
+  std::vector<Partial> partials(num_threads, Partial{details::EquityTally(hole_cards.size())});
+
+  details::run_work_stealing(num_blocks, num_threads, [&](size_t worker, size_t block) {
+    uint64_t begin = block * details::kSamplesPerBlock;
+    uint64_t count = std::min(details::kSamplesPerBlock, num_samples - begin);
+    details::dispatch_equity_block(phe, holes, board, dealer, Xoshiro256::for_stream(seed, block), count,
+                                   &partials[worker].tally);
+  });
+
+  for (size_t i = 1; i < num_threads; i++) {
+    partials[0].tally.merge(partials[i].tally);
+  }
+  return partials[0].tally.result();
+}
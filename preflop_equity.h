@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "poker_hand_eval.h"
+
+// Precomputed heads-up preflop all-in equities, as written by
+// bin/generate_preflop.
+//
+// Two granularities are supported:
+//   * 169 canonical starting hands (pairs, suited and offsuit combinations),
+//     where each entry is the average over every non-conflicting pair of
+//     concrete combos.
+//   * 1326 concrete two-card combos. Entries for combos that share a card are
+//     NaN.
+//
+// Example usage:
+//   PreflopEquity preflop("/path/to/preflop169.eq");
+//   float eq = preflop.equity(canonical_preflop_hand(48, 49),
+//                             canonical_preflop_hand(44, 40));
+//
+// Like the *.phe tables, the files assume rank-major cards (card = 4 * rank +
+// suit); regenerate them if the card mapping changes.
+
+// Returns the canonical starting hand of two distinct cards, in [0, 169).
+// The hands form a 13x13 grid indexed by rank: pairs lie on the diagonal,
+// suited hands have the higher rank as row, offsuit hands as column.
+inline uint32_t canonical_preflop_hand(uint32_t card1, uint32_t card2) {
+  uint32_t rank1 = card1 / 4;
+  uint32_t rank2 = card2 / 4;
+  uint32_t high = std::max(rank1, rank2);
+  uint32_t low = std::min(rank1, rank2);
+  if (card1 % 4 == card2 % 4) {
+    return high * 13 + low;
+  }
+  return low * 13 + high;
+}
+
+// Returns the index of a concrete two-card combo, in [0, 1326).
+inline uint32_t preflop_combo(uint32_t card1, uint32_t card2) {
+  uint32_t high = std::max(card1, card2);
+  uint32_t low = std::min(card1, card2);
+  return high * (high - 1) / 2 + low;
+}
+
+// On-disk layout of an equity file: this header, followed by a row-major
+// num_hands x num_hands matrix of float pot shares of the row hand against
+// the column hand.
+struct PreflopEquityHeader {
+  static constexpr char kMagic[8] = {'P', 'H', 'E', 'P', 'R', 'E', 'Q', '\0'};
+  static constexpr uint32_t kVersion = 1;
+
+  char magic[8];
+  uint32_t version;
+  // 169 or 1326.
+  uint32_t num_hands;
+};
+
+class PreflopEquity {
+ public:
+  // Maps the file read-only by default, so that every process on the host
+  // shares one copy.
+  explicit PreflopEquity(const std::string& path);
+  PreflopEquity(const std::string& path, const PheLoadOptions& options);
+
+  // 169 for canonical hands, 1326 for concrete combos.
+  uint32_t num_hands() const { return num_hands_; }
+
+  // Pot share of `hand` all-in against `opponent`, both given as indices
+  // from canonical_preflop_hand or preflop_combo, matching num_hands().
+  float equity(uint32_t hand, uint32_t opponent) const {
+    return matrix_[hand * num_hands_ + opponent];
+  }
+
+  // Pot share of hole cards (a1, a2) against (b1, b2).
+  float equity(uint32_t a1, uint32_t a2, uint32_t b1, uint32_t b2) const {
+    if (num_hands_ == 169) {
+      return equity(canonical_preflop_hand(a1, a2), canonical_preflop_hand(b1, b2));
+    }
+    return equity(preflop_combo(a1, a2), preflop_combo(b1, b2));
+  }
+
+ private:
+  const float* matrix_ = nullptr;
+  uint32_t num_hands_ = 0;
+  std::shared_ptr<const void> storage_;
+};
+
+//////////////////////////////////
+// Implementation details below //
+//////////////////////////////////
+
+inline PreflopEquity::PreflopEquity(const std::string& path)
+    : PreflopEquity(path, [] {
+        PheLoadOptions options;
+        options.mode = PheLoadOptions::Mode::kMmap;
+        return options;
+      }()) {}
+
+inline PreflopEquity::PreflopEquity(const std::string& path, const PheLoadOptions& options) {
+  size_t num_bytes = 0;
+  storage_ = details::load_table(path, options, &num_bytes);
+
+  PreflopEquityHeader header;
+  if (num_bytes < sizeof(header)) {
+    throw std::runtime_error(path + ": truncated preflop equity file");
+  }
+  std::memcpy(&header, storage_.get(), sizeof(header));
+  if (std::memcmp(header.magic, PreflopEquityHeader::kMagic, sizeof(header.magic)) != 0 ||
+      header.version != PreflopEquityHeader::kVersion) {
+    throw std::runtime_error(path + ": not a preflop equity file");
+  }
+  if (num_bytes != sizeof(header) + sizeof(float) * header.num_hands * header.num_hands) {
+    throw std::runtime_error(path + ": truncated preflop equity file");
+  }
+
+  num_hands_ = header.num_hands;
+  matrix_ = reinterpret_cast<const float*>(static_cast<const char*>(storage_.get()) + sizeof(header));
+}
@@ -0,0 +1,221 @@
+#include "service/phe_client.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "service/phe_service.h"
+
+using namespace phe_service;
+
+struct phe_client {
+  int socket_fd = -1;
+  Segment* segment = nullptr;
+  // Mirror of segment->submitted; only this client writes it.
+  uint32_t submitted = 0;
+  bool disconnected = false;
+};
+
+namespace {
+
+// Receives the segment's memfd sent by the daemon with SCM_RIGHTS.
+int receive_fd(int socket_fd) {
+  char byte;
+  struct iovec iov = {&byte, 1};
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t n;
+  do {
+    n = recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC);
+  } while (n < 0 && errno == EINTR);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (n != 1 || cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS) {
+    errno = EPROTO;
+    return -1;
+  }
+  int fd;
+  std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+  return fd;
+}
+
+// Claims the next slot, waiting while all of them are in flight. Returns
+// nullptr if the daemon is gone.
+Slot* next_slot(phe_client* client) {
+  Segment* segment = client->segment;
+  uint32_t completed = segment->completed.load(std::memory_order_acquire);
+  while (client->submitted - completed >= kNumSlots) {
+    if (!wait_for_change(&segment->completed, completed, &segment->client_waiting, client->socket_fd)) {
+      client->disconnected = true;
+      return nullptr;
+    }
+    completed = segment->completed.load(std::memory_order_acquire);
+  }
+  return &segment->slots[client->submitted % kNumSlots];
+}
+
+void submit(phe_client* client) {
+  client->submitted++;
+  publish(&client->segment->submitted, client->submitted, &client->segment->server_waiting);
+}
+
+// Waits until the request numbered `request` is complete.
+bool wait_for(phe_client* client, uint32_t request) {
+  Segment* segment = client->segment;
+  uint32_t completed = segment->completed.load(std::memory_order_acquire);
+  // Counters wrap; a request is complete once it is behind `completed`.
+  while (static_cast<int32_t>(completed - request) <= 0) {
+    if (!wait_for_change(&segment->completed, completed, &segment->client_waiting, client->socket_fd)) {
+      client->disconnected = true;
+      return false;
+    }
+    completed = segment->completed.load(std::memory_order_acquire);
+  }
+  return true;
+}
+
+}  // namespace
+
+phe_client* phe_connect(const char* socket_path) {
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (std::strlen(socket_path) >= sizeof(addr.sun_path)) {
+    errno = ENAMETOOLONG;
+    return nullptr;
+  }
+  std::strcpy(addr.sun_path, socket_path);
+
+  int socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (socket_fd < 0) {
+    return nullptr;
+  }
+  if (connect(socket_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+    int saved_errno = errno;
+    close(socket_fd);
+    errno = saved_errno;
+    return nullptr;
+  }
+
+  int segment_fd = receive_fd(socket_fd);
+  void* addr_map = MAP_FAILED;
+  if (segment_fd >= 0) {
+    addr_map = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd, 0);
+    close(segment_fd);
+  }
+  if (addr_map == MAP_FAILED) {
+    int saved_errno = errno;
+    close(socket_fd);
+    errno = saved_errno;
+    return nullptr;
+  }
+
+  auto segment = static_cast<Segment*>(addr_map);
+  if (std::memcmp(segment->magic, kMagic, sizeof(kMagic)) != 0 || segment->version != kVersion ||
+      segment->num_slots != kNumSlots || segment->slot_hands != kSlotHands) {
+    munmap(segment, sizeof(Segment));
+    close(socket_fd);
+    errno = EPROTO;
+    return nullptr;
+  }
+
+  auto client = new phe_client;
+  client->socket_fd = socket_fd;
+  client->segment = segment;
+  client->submitted = segment->submitted.load(std::memory_order_relaxed);
+  return client;
+}
+
+void phe_disconnect(phe_client* client) {
+  if (client == nullptr) {
+    return;
+  }
+  munmap(client->segment, sizeof(Segment));
+  close(client->socket_fd);
+  delete client;
+}
+
+uint32_t phe_hand_size(const phe_client* client) {
+  return client->segment->hand_size;
+}
+
+int phe_eval_batch(phe_client* client, const uint8_t* cards, size_t num_hands, uint32_t* scores) {
+  if (client->disconnected) {
+    return PHE_EDISCONNECTED;
+  }
+  const uint32_t hand_size = client->segment->hand_size;
+
+  // Keeps up to kNumSlots requests in flight: slots are filled as soon as
+  // they free up, and collected in order.
+  const uint32_t first_request = client->submitted;
+  size_t num_submitted = 0;
+  size_t num_collected = 0;
+  while (num_collected < num_hands) {
+    while (num_submitted < num_hands && client->submitted - first_request - num_collected / kSlotHands < kNumSlots) {
+      Slot* slot = next_slot(client);
+      if (slot == nullptr) {
+        return PHE_EDISCONNECTED;
+      }
+      uint32_t n = std::min<size_t>(kSlotHands, num_hands - num_submitted);
+      slot->op = Op::kEvalBatch;
+      slot->num_hands = n;
+      std::memcpy(slot->cards, cards + num_submitted * hand_size, n * hand_size);
+      submit(client);
+      num_submitted += n;
+    }
+
+    uint32_t request = first_request + num_collected / kSlotHands;
+    if (!wait_for(client, request)) {
+      return PHE_EDISCONNECTED;
+    }
+    const Slot& slot = client->segment->slots[request % kNumSlots];
+    uint32_t n = std::min<size_t>(kSlotHands, num_hands - num_collected);
+    std::memcpy(scores + num_collected, slot.scores, n * sizeof(uint32_t));
+    num_collected += n;
+  }
+  return PHE_OK;
+}
+
+int phe_sweep(phe_client* client,
+              const uint8_t* prefix,
+              size_t prefix_size,
+              const uint8_t* dead,
+              size_t num_dead,
+              uint32_t reference_score,
+              uint64_t counts[3]) {
+  if (client->disconnected) {
+    return PHE_EDISCONNECTED;
+  }
+  if (prefix_size >= client->segment->hand_size || num_dead > 52) {
+    return PHE_EINVAL;
+  }
+  Slot* slot = next_slot(client);
+  if (slot == nullptr) {
+    return PHE_EDISCONNECTED;
+  }
+  slot->op = Op::kSweep;
+  slot->prefix_size = prefix_size;
+  slot->num_dead = num_dead;
+  slot->reference_score = reference_score;
+  std::memcpy(slot->prefix, prefix, prefix_size);
+  std::memcpy(slot->dead, dead, num_dead);
+  uint32_t request = client->submitted;
+  submit(client);
+
+  if (!wait_for(client, request)) {
+    return PHE_EDISCONNECTED;
+  }
+  if (slot->status != Status::kOk) {
+    return PHE_EINVAL;
+  }
+  std::copy_n(slot->counts, 3, counts);
+  return PHE_OK;
+}
@@ -0,0 +1,65 @@
+#ifndef PHE_CLIENT_H_
+#define PHE_CLIENT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// C client of phe_daemon, which serves one table to every process on the host
+// over shared memory (see phe_service.h). Build with `make bin/libphe_client.so`
+// and link it, or load it through any FFI.
+//
+// Example usage:
+//   phe_client* client = phe_connect("/tmp/phe.sock");
+//   uint8_t hands[2][7] = {{37, 0, 48, 26, 7, 5, 8}, {1, 2, 3, 4, 5, 6, 7}};
+//   uint32_t scores[2];
+//   phe_eval_batch(client, &hands[0][0], 2, scores);
+//   phe_disconnect(client);
+//
+// Cards and scores are those of the daemon's table. A client is one ring and
+// must not be used by several threads at once; connect once per thread.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PHE_OK 0
+// An argument is out of range: a card outside [0, 52), a repeated card, a
+// prefix of hand_size cards or more.
+#define PHE_EINVAL (-1)
+// The daemon has gone away; the client can only be disconnected.
+#define PHE_EDISCONNECTED (-2)
+
+typedef struct phe_client phe_client;
+
+// Connects to the daemon listening on socket_path. Returns NULL, with errno
+// set, on failure.
+phe_client* phe_connect(const char* socket_path);
+
+void phe_disconnect(phe_client* client);
+
+// Number of cards in a hand of the daemon's table.
+uint32_t phe_hand_size(const phe_client* client);
+
+// Scores num_hands hands of phe_hand_size() cards, packed back to back in
+// `cards`, into scores[0, num_hands). Batches of any size are split across
+// the ring's slots and pipelined. A hand with a card out of range scores
+// UINT32_MAX.
+int phe_eval_batch(phe_client* client, const uint8_t* cards, size_t num_hands, uint32_t* scores);
+
+// Sweeps every hand that starts with the prefix_size cards of `prefix` and
+// avoids the num_dead cards of `dead`. counts[0], counts[1] and counts[2]
+// receive how many of them score better than (below), the same as and worse
+// than reference_score. prefix_size must be below phe_hand_size().
+int phe_sweep(phe_client* client,
+              const uint8_t* prefix,
+              size_t prefix_size,
+              const uint8_t* dead,
+              size_t num_dead,
+              uint32_t reference_score,
+              uint64_t counts[3]);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // PHE_CLIENT_H_
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <array>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "poker_hand_eval.h"
+#include "service/phe_service.h"
+
+using namespace phe_service;
+
+namespace {
+
+// Hands of a kEvalBatch slot are copied out and checked kBatchLanes at a
+// time: the slot is shared with the client, which could rewrite a card after
+// it was checked and walk the daemon off the table.
+template <uint8_t hand_size>
+void eval_batch(const PokerHandEval<hand_size>& phe, Slot* slot) {
+  const uint32_t num_hands = std::min(slot->num_hands, kSlotHands);
+  std::array<uint8_t, hand_size> hands[details::kBatchLanes];
+  uint32_t scores[details::kBatchLanes];
+  for (uint32_t i = 0; i < num_hands; i += details::kBatchLanes) {
+    uint32_t num_lanes = std::min<uint32_t>(details::kBatchLanes, num_hands - i);
+    std::memcpy(hands, slot->cards + i * hand_size, num_lanes * hand_size);
+    uint8_t max_card = 0;
+    for (uint32_t lane = 0; lane < num_lanes; lane++) {
+      max_card = std::max(max_card, *std::max_element(hands[lane].begin(), hands[lane].end()));
+    }
+    if (max_card < 52) {
+      phe.eval_batch(hands, scores, num_lanes);
+    } else {
+      for (uint32_t lane = 0; lane < num_lanes; lane++) {
+        bool valid = *std::max_element(hands[lane].begin(), hands[lane].end()) < 52;
+        scores[lane] = valid ? phe.eval(hands[lane]) : kInvalidScore;
+      }
+    }
+    std::memcpy(slot->scores + i, scores, num_lanes * sizeof(uint32_t));
+  }
+  slot->status = Status::kOk;
+}
+
+template <uint8_t hand_size>
+void sweep(const PokerHandEval<hand_size>& phe, Slot* slot) {
+  const uint32_t prefix_size = slot->prefix_size;
+  const uint32_t num_dead = slot->num_dead;
+  const uint32_t reference_score = slot->reference_score;
+  if (prefix_size >= hand_size || num_dead > 52) {
+    slot->status = Status::kInvalidArgument;
+    return;
+  }
+  std::vector<uint32_t> prefix(slot->prefix, slot->prefix + prefix_size);
+  std::vector<uint32_t> dead(slot->dead, slot->dead + num_dead);
+  uint64_t used = 0;
+  for (uint32_t card : prefix) {
+    if (card >= 52 || (used >> card & 1)) {
+      slot->status = Status::kInvalidArgument;
+      return;
+    }
+    used |= uint64_t{1} << card;
+  }
+  for (uint32_t card : dead) {
+    if (card >= 52) {
+      slot->status = Status::kInvalidArgument;
+      return;
+    }
+  }
+
+  using Counts = std::array<uint64_t, 3>;
+  Counts counts = phe.parallel_sweep_blocks(
+      prefix, dead, Counts{},
+      [&](Counts* c, const auto&, const uint32_t* scores, uint64_t valid_cards) {
+        for (; valid_cards; valid_cards &= valid_cards - 1) {
+          uint32_t score = scores[__builtin_ctzll(valid_cards)];
+          (*c)[score < reference_score ? 0 : score == reference_score ? 1 : 2]++;
+        }
+      },
+      [](Counts* total, const Counts& c) {
+        for (size_t i = 0; i < c.size(); i++) {
+          (*total)[i] += c[i];
+        }
+      },
+      1);
+  std::copy(counts.begin(), counts.end(), slot->counts);
+  slot->status = Status::kOk;
+}
+
+// Serves one client's ring until it disconnects. Each client gets its own
+// thread; the table is shared by all of them.
+template <uint8_t hand_size>
+void serve(const PokerHandEval<hand_size>& phe, int socket_fd, Segment* segment) {
+  uint32_t completed = 0;
+  while (true) {
+    uint32_t submitted = segment->submitted.load(std::memory_order_acquire);
+    if (submitted == completed) {
+      if (!wait_for_change(&segment->submitted, completed, &segment->server_waiting, socket_fd)) {
+        break;
+      }
+      continue;
+    }
+    // A client more than kNumSlots ahead has overwritten its own requests.
+    if (submitted - completed > kNumSlots) {
+      break;
+    }
+    for (; completed != submitted; completed++) {
+      Slot* slot = &segment->slots[completed % kNumSlots];
+      switch (slot->op) {
+        case Op::kEvalBatch:
+          eval_batch(phe, slot);
+          break;
+        case Op::kSweep:
+          sweep(phe, slot);
+          break;
+        default:
+          slot->status = Status::kInvalidArgument;
+      }
+      publish(&segment->completed, completed + 1, &segment->client_waiting);
+    }
+  }
+  munmap(segment, sizeof(Segment));
+  close(socket_fd);
+}
+
+// Creates a client's segment and passes it over the socket. Returns nullptr
+// on failure.
+Segment* send_segment(int socket_fd, uint32_t hand_size) {
+  int segment_fd = memfd_create("phe_segment", MFD_CLOEXEC);
+  if (segment_fd < 0 || ftruncate(segment_fd, sizeof(Segment)) != 0) {
+    perror("memfd");
+    if (segment_fd >= 0) {
+      close(segment_fd);
+    }
+    return nullptr;
+  }
+  void* addr = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd, 0);
+  if (addr == MAP_FAILED) {
+    perror("mmap");
+    close(segment_fd);
+    return nullptr;
+  }
+  auto segment = new (addr) Segment();
+  std::memcpy(segment->magic, kMagic, sizeof(kMagic));
+  segment->version = kVersion;
+  segment->hand_size = hand_size;
+  segment->num_slots = kNumSlots;
+  segment->slot_hands = kSlotHands;
+
+  char byte = 0;
+  struct iovec iov = {&byte, 1};
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &segment_fd, sizeof(int));
+  ssize_t n = sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+  close(segment_fd);
+  if (n != 1) {
+    munmap(addr, sizeof(Segment));
+    return nullptr;
+  }
+  return segment;
+}
+
+std::string socket_path_to_unlink;
+
+void unlink_and_exit(int) {
+  unlink(socket_path_to_unlink.c_str());
+  _exit(0);
+}
+
+template <uint8_t hand_size>
+int run(const std::string& table_path, int listen_fd) {
+  // Mapped, so that the daemon itself shares the page cache's copy.
+  PheLoadOptions options;
+  options.mode = PheLoadOptions::Mode::kMmap;
+  options.populate = true;
+  PokerHandEval<hand_size> phe(table_path, options);
+
+  while (true) {
+    int socket_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (socket_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      perror("accept");
+      return 1;
+    }
+    Segment* segment = send_segment(socket_fd, hand_size);
+    if (segment == nullptr) {
+      close(socket_fd);
+      continue;
+    }
+    std::thread(serve<hand_size>, std::cref(phe), socket_fd, segment).detach();
+  }
+}
+
+// "tables/bfs7.phe" -> "bfs7".
+std::string file_stem(const std::string& path) {
+  size_t begin = path.find_last_of('/');
+  begin = (begin == std::string::npos ? 0 : begin + 1);
+  size_t end = path.find('.', begin);
+  return path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+}  // namespace
+
+// Serves one table to every client on the host; see phe_service.h and
+// phe_client.h.
+//
+// Usage: phe_daemon [--hand-size N] [--socket PATH] table.phe
+//
+// The socket defaults to /tmp/phe.sock, and the hand size to the one spelled
+// by the table name, as in bfs7.phe.
+int main(int argc, char** argv) {
+  std::string socket_path = "/tmp/phe.sock";
+  uint32_t hand_size = 0;
+  std::string table_path;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--hand-size" && i + 1 < argc) {
+      hand_size = std::stoul(argv[++i]);
+    } else if (arg == "--socket" && i + 1 < argc) {
+      socket_path = argv[++i];
+    } else if (arg.rfind("--", 0) != 0 && table_path.empty()) {
+      table_path = arg;
+    } else {
+      table_path.clear();
+      break;
+    }
+  }
+  if (table_path.empty()) {
+    fprintf(stderr, "Usage: %s [--hand-size N] [--socket PATH] table.phe\n", argv[0]);
+    return 1;
+  }
+
+  std::string stem = file_stem(table_path);
+  size_t digits = stem.find_last_not_of("0123456789") + 1;
+  if (hand_size == 0 && digits < stem.size()) {
+    hand_size = std::stoul(stem.substr(digits));
+  }
+  if (hand_size != 5 && hand_size != 7) {
+    fprintf(stderr, "%s: cannot infer a hand size of 5 or 7, pass --hand-size\n", table_path.c_str());
+    return 1;
+  }
+
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "%s: socket path too long\n", socket_path.c_str());
+    return 1;
+  }
+  std::strcpy(addr.sun_path, socket_path.c_str());
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  unlink(socket_path.c_str());
+  if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(listen_fd, SOMAXCONN) != 0) {
+    perror(socket_path.c_str());
+    return 1;
+  }
+  socket_path_to_unlink = socket_path;
+  signal(SIGINT, unlink_and_exit);
+  signal(SIGTERM, unlink_and_exit);
+
+  try {
+    return hand_size == 5 ? run<5>(table_path, listen_fd) : run<7>(table_path, listen_fd);
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    unlink(socket_path.c_str());
+    return 1;
+  }
+}
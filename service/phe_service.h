@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PHE_HAVE_X86_SIMD 1
+#endif
+
+#include <linux/futex.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Wire format shared by phe_daemon and the client library (phe_client.h).
+//
+// A client connects to the daemon's unix socket and receives, as SCM_RIGHTS,
+// a memfd holding one Segment. From then on the socket carries nothing; it
+// only tells each side when the other has gone away.
+//
+// The Segment is a single-producer/single-consumer ring of kNumSlots request
+// slots. The client fills slot `submitted % kNumSlots` and bumps `submitted`;
+// the daemon serves slots in order, writes the results into the same slot and
+// bumps `completed`. A slot is the client's again once `completed` has passed
+// it, so at most kNumSlots requests are in flight. The two counters live on
+// their own cache lines: a request costs the slot's lines plus the two
+// counter lines, and no syscall while both sides are busy.
+//
+// A side that finds nothing to do spins briefly, then sleeps on the other
+// side's counter with a futex. It sets its `*_waiting` flag first, so the
+// other side knows to issue the wake-up; otherwise no futex call is made.
+namespace phe_service {
+
+constexpr char kMagic[8] = {'P', 'H', 'E', 'S', 'H', 'M', '\0', '\0'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kNumSlots = 8;
+// Most hands in one kEvalBatch slot; larger batches span several slots.
+constexpr uint32_t kSlotHands = 512;
+constexpr uint32_t kMaxHandSize = 7;
+
+enum class Op : uint32_t {
+  // Scores num_hands hands of hand_size cards from `cards` into `scores`.
+  kEvalBatch = 1,
+  // Counts the hands that complete `prefix` without using `dead` cards, by
+  // how they compare to `reference_score`: better, tied and worse.
+  kSweep = 2,
+};
+
+enum class Status : uint32_t {
+  kOk = 0,
+  kInvalidArgument = 1,
+};
+
+// Score of a hand with a card out of range in kEvalBatch.
+constexpr uint32_t kInvalidScore = UINT32_MAX;
+
+struct alignas(64) Slot {
+  Op op;
+  Status status;
+  // kEvalBatch: number of hands, at most kSlotHands.
+  uint32_t num_hands;
+  // kSweep: the prefix has fewer than hand_size cards.
+  uint32_t prefix_size;
+  uint32_t num_dead;
+  uint32_t reference_score;
+  uint8_t prefix[kMaxHandSize];
+  uint8_t dead[52];
+  // kSweep results: hands scoring below, equal to and above reference_score.
+  uint64_t counts[3];
+  // kEvalBatch: hand i is cards[i * hand_size, (i + 1) * hand_size).
+  uint8_t cards[kSlotHands * kMaxHandSize];
+  uint32_t scores[kSlotHands];
+};
+
+struct Segment {
+  char magic[8];
+  uint32_t version;
+  uint32_t hand_size;
+  uint32_t num_slots;
+  uint32_t slot_hands;
+
+  // Written by the client.
+  alignas(64) std::atomic<uint32_t> submitted;
+  std::atomic<uint32_t> client_waiting;
+  // Written by the daemon.
+  alignas(64) std::atomic<uint32_t> completed;
+  std::atomic<uint32_t> server_waiting;
+
+  Slot slots[kNumSlots];
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+              "Futexes need plain 32-bit atomics.");
+
+// Pauses before a side gives up spinning and sleeps.
+constexpr uint32_t kSpinIterations = 2048;
+// How long a sleeper waits before checking that its peer is still alive.
+constexpr int kSleepMs = 100;
+
+// Eases a spin-wait loop on the core, where the CPU has a hint for it.
+inline void cpu_relax() {
+#ifdef PHE_HAVE_X86_SIMD
+  _mm_pause();
+#endif
+}
+
+inline void futex_wait(std::atomic<uint32_t>* word, uint32_t expected, int timeout_ms) {
+  struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+// Whether the other end of the connected socket `fd` has closed it.
+inline bool peer_hung_up(int fd) {
+  struct pollfd p = {fd, POLLIN, 0};
+  char byte;
+  return poll(&p, 1, 0) > 0 && (p.revents & (POLLHUP | POLLERR) ||
+                                (p.revents & POLLIN && recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0));
+}
+
+// Waits until `word` differs from `seen`, spinning first and then sleeping
+// with `*waiting` raised. Returns false if `fd`'s peer hangs up meanwhile.
+inline bool wait_for_change(std::atomic<uint32_t>* word,
+                            uint32_t seen,
+                            std::atomic<uint32_t>* waiting,
+                            int fd) {
+  for (uint32_t i = 0; i < kSpinIterations; i++) {
+    if (word->load(std::memory_order_acquire) != seen) {
+      return true;
+    }
+    cpu_relax();
+    // On an oversubscribed host the peer may need this core.
+    if (i % 256 == 255) {
+      sched_yield();
+    }
+  }
+  while (true) {
+    waiting->store(1, std::memory_order_seq_cst);
+    if (word->load(std::memory_order_seq_cst) != seen) {
+      break;
+    }
+    futex_wait(word, seen, kSleepMs);
+    if (word->load(std::memory_order_acquire) != seen) {
+      break;
+    }
+    if (peer_hung_up(fd)) {
+      waiting->store(0, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  waiting->store(0, std::memory_order_relaxed);
+  return true;
+}
+
+// Publishes `value` to `word`, waking the peer if it went to sleep on it.
+inline void publish(std::atomic<uint32_t>* word, uint32_t value, std::atomic<uint32_t>* peer_waiting) {
+  word->store(value, std::memory_order_seq_cst);
+  if (peer_waiting->load(std::memory_order_seq_cst) != 0) {
+    futex_wake(word);
+  }
+}
+
+}  // namespace phe_service
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "poker_hand_eval.h"
+
+// Evaluator for unified tables (tables/unified7.phe), which score hands of
+// several sizes from one table.
+//
+// A unified table is a 7-card table whose rows carry a 53rd slot: for rows
+// reached by 5 or 6 cards, it holds the score of those cards. An n-card hand
+// walks n hops as usual; unless n is the maximum size, the score is then read
+// from the last slot of the row reached. Stud, 6-card and Hold'em queries
+// thus share one cache-resident working set instead of loading bfs5.phe and
+// bfs7.phe side by side.
+//
+// Example usage:
+//   UnifiedPokerHandEval<5, 7> phe("/path/to/unified7.phe");
+//   auto score5 = phe.eval(37, 0, 48, 26, 7);
+//   auto score6 = phe.eval(37, 0, 48, 26, 7, 5);
+//   auto score7 = phe.eval(37, 0, 48, 26, 7, 5, 8);
+//
+// Scores are identical to those of PokerHandEval over the same card mapping.
+template <uint8_t min_hand_size, uint8_t max_hand_size>
+class UnifiedPokerHandEval {
+ public:
+  static constexpr uint32_t kRowSize = 53;
+
+  UnifiedPokerHandEval(const std::string& path);
+  UnifiedPokerHandEval(const std::string& path, const PheLoadOptions& options);
+  UnifiedPokerHandEval(const UnifiedPokerHandEval&) = delete;
+  // The moved-from evaluator is left empty, with no table.
+  UnifiedPokerHandEval(UnifiedPokerHandEval&& other) noexcept;
+  UnifiedPokerHandEval& operator=(UnifiedPokerHandEval&& other) noexcept;
+
+  template <typename... CardType>
+  uint32_t eval(CardType... hand) const;
+
+  // Evaluates the first num_cards cards of `hand`. num_cards must lie in
+  // [min_hand_size, max_hand_size].
+  template <typename Container>
+  uint32_t eval_n(const Container& hand, size_t num_cards) const;
+
+  // Evaluates every card of `hand`.
+  template <typename Container>
+  uint32_t eval(const Container& hand) const {
+    return eval_n(hand, std::size(hand));
+  }
+
+ private:
+  const uint32_t* table_ = nullptr;
+  std::shared_ptr<const void> storage_;
+};
+
+// On-disk layout of a unified table: this header, then num_entries uint32_t
+// slots in rows of 53.
+struct UnifiedPheHeader {
+  static constexpr char kMagic[8] = {'P', 'H', 'E', 'U', '\0', '\0', '\0', '\0'};
+  static constexpr uint32_t kVersion = 1;
+
+  char magic[8];
+  uint32_t version;
+  // Smallest hand size with scored rows, and the hand size of the terminal
+  // level.
+  uint32_t min_hand_size;
+  uint32_t max_hand_size;
+  uint32_t reserved;
+  uint64_t num_entries;
+};
+
+//////////////////////////////////
+// Implementation details below //
+//////////////////////////////////
+
+template <uint8_t min_hand_size, uint8_t max_hand_size>
+UnifiedPokerHandEval<min_hand_size, max_hand_size>::UnifiedPokerHandEval(const std::string& path)
+    : UnifiedPokerHandEval(path, PheLoadOptions()) {}
+
+template <uint8_t min_hand_size, uint8_t max_hand_size>
+UnifiedPokerHandEval<min_hand_size, max_hand_size>::UnifiedPokerHandEval(const std::string& path,
+                                                                         const PheLoadOptions& options) {
+  static_assert(min_hand_size <= max_hand_size, "Empty range of hand sizes.");
+
+  size_t num_bytes = 0;
+  storage_ = details::load_table(path, options, &num_bytes);
+
+  UnifiedPheHeader header;
+  if (num_bytes < sizeof(header)) {
+    throw std::runtime_error(path + ": truncated unified table");
+  }
+  std::memcpy(&header, storage_.get(), sizeof(header));
+  if (std::memcmp(header.magic, UnifiedPheHeader::kMagic, sizeof(header.magic)) != 0 ||
+      header.version != UnifiedPheHeader::kVersion) {
+    throw std::runtime_error(path + ": not a unified table");
+  }
+  if (header.max_hand_size != max_hand_size || header.min_hand_size > min_hand_size) {
+    throw std::runtime_error(path + ": table does not cover the requested hand sizes");
+  }
+  if (num_bytes != sizeof(header) + header.num_entries * sizeof(uint32_t)) {
+    throw std::runtime_error(path + ": truncated unified table");
+  }
+
+  table_ = reinterpret_cast<const uint32_t*>(static_cast<const char*>(storage_.get()) + sizeof(header));
+}
+
+template <uint8_t min_hand_size, uint8_t max_hand_size>
+UnifiedPokerHandEval<min_hand_size, max_hand_size>::UnifiedPokerHandEval(
+    UnifiedPokerHandEval&& other) noexcept
+    : table_(std::exchange(other.table_, nullptr)), storage_(std::move(other.storage_)) {}
+
+template <uint8_t min_hand_size, uint8_t max_hand_size>
+UnifiedPokerHandEval<min_hand_size, max_hand_size>&
+UnifiedPokerHandEval<min_hand_size, max_hand_size>::operator=(
+    UnifiedPokerHandEval&& other) noexcept {
+  if (this != &other) {
+    table_ = std::exchange(other.table_, nullptr);
+    storage_ = std::move(other.storage_);
+  }
+  return *this;
+}
+
+template <uint8_t min_hand_size, uint8_t max_hand_size>
+template <typename... CardType>
+uint32_t UnifiedPokerHandEval<min_hand_size, max_hand_size>::eval(CardType... hand) const {
+  static_assert(sizeof...(hand) >= min_hand_size && sizeof...(hand) <= max_hand_size,
+                "Wrong number of arguments.");
+  const uint32_t cards[] = {static_cast<uint32_t>(hand)...};
+  return eval_n(cards, sizeof...(hand));
+}
+
+template <uint8_t min_hand_size, uint8_t max_hand_size>
+template <typename Container>
+uint32_t UnifiedPokerHandEval<min_hand_size, max_hand_size>::eval_n(const Container& hand,
+                                                                  size_t num_cards) const {
+  auto it = std::begin(hand);
+  uint32_t index = 0;
+  for (size_t i = 0; i < num_cards; i++, ++it) {
+    index = table_[index + *it];
+  }
+  return num_cards == max_hand_size ? index : table_[index + kRowSize - 1];
+}